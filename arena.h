@@ -0,0 +1,131 @@
+#ifndef ARENA_H
+#define ARENA_H
+
+#include <cstddef>
+#include <cstdint>
+#include <memory_resource>
+#include <new>
+#include <sys/mman.h>
+
+// Bump allocator that owns all the node storage of one net. Memory comes from
+// mmap'ed chunks that are kept across reset(), so running many nets in one
+// process reuses the same pages instead of going back to malloc every time.
+// Individual deallocation is a no-op, everything is released by reset().
+class Arena : public std::pmr::memory_resource {
+public:
+    explicit Arena(bool use_huge_pages = false, size_t min_chunk = 64 << 20)
+        : huge_pages(use_huge_pages), chunk_size(roundUp(min_chunk)),
+          head(nullptr), tail(nullptr), current(nullptr), offset(0) {}
+
+    Arena(const Arena&) = delete;
+    Arena& operator=(const Arena&) = delete;
+
+    ~Arena() {
+        Chunk* c = head;
+        while (c) {
+            Chunk* next = c->next;
+            munmap(c, c->size);
+            c = next;
+        }
+    }
+
+    // rewinds to the first chunk, O(1) no matter how much was allocated
+    void reset() {
+        current = head;
+        offset = sizeof(Chunk);
+    }
+
+    size_t reserved() const {
+        size_t total = 0;
+        for (Chunk* c = head; c; c = c->next) {
+            total += c->size;
+        }
+        return total;
+    }
+
+private:
+    struct Chunk {
+        size_t size;
+        Chunk* next;
+    };
+
+    bool huge_pages;
+    size_t chunk_size;
+    Chunk* head;
+    Chunk* tail;
+    Chunk* current;
+    size_t offset;   // next free byte in current
+
+    static constexpr size_t page = 2 << 20;   // also the huge page size on x86-64
+
+    static size_t roundUp(size_t bytes) {
+        return (bytes + page - 1) / page * page;
+    }
+
+    Chunk* mapChunk(size_t size) {
+        void* p = MAP_FAILED;
+#ifdef MAP_HUGETLB
+        if (huge_pages) {
+            // only works if huge pages were reserved, otherwise fall back below
+            p = mmap(nullptr, size, PROT_READ | PROT_WRITE,
+                     MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+        }
+#endif
+        if (p == MAP_FAILED) {
+            p = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (p == MAP_FAILED) {
+                throw std::bad_alloc();
+            }
+#ifdef MADV_HUGEPAGE
+            if (huge_pages) {
+                madvise(p, size, MADV_HUGEPAGE);   // transparent huge pages
+            }
+#endif
+        }
+        Chunk* c = static_cast<Chunk*>(p);
+        c->size = size;
+        c->next = nullptr;
+        if (tail) {
+            tail->next = c;
+        } else {
+            head = c;
+        }
+        tail = c;
+        return c;
+    }
+
+    void* do_allocate(size_t bytes, size_t alignment) override {
+        if (current) {
+            size_t start = (offset + alignment - 1) & ~(alignment - 1);
+            if (start + bytes <= current->size) {
+                offset = start + bytes;
+                return reinterpret_cast<char*>(current) + start;
+            }
+        }
+
+        // current chunk is full, move on to the next one that is big enough
+        size_t need = (sizeof(Chunk) + alignment - 1) / alignment * alignment + bytes;
+        Chunk* c = current ? current->next : head;
+        while (c && c->size < need) {
+            c = c->next;
+        }
+        if (!c) {
+            c = mapChunk(roundUp(need > chunk_size ? need : chunk_size));
+        }
+        current = c;
+        offset = sizeof(Chunk);
+        size_t start = (offset + alignment - 1) & ~(alignment - 1);
+        offset = start + bytes;
+        return reinterpret_cast<char*>(current) + start;
+    }
+
+    void do_deallocate(void*, size_t, size_t) override {
+        // released in bulk by reset()
+    }
+
+    bool do_is_equal(const std::pmr::memory_resource& other) const noexcept override {
+        return this == &other;
+    }
+};
+
+#endif
@@ -0,0 +1,133 @@
+#include "batch.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <chrono>
+#include <atomic>
+#include <map>
+#include <memory>
+#include <vector>
+#include "tree.h"
+using namespace std;
+
+struct BatchRow {
+    double constraint;
+    std::string inv, wire, topology;
+    std::string out1, out2, out3, out4;
+};
+
+static int readManifest(const std::string& filename, std::vector<BatchRow>& rows) {
+    std::ifstream fin(filename);
+    if (!fin) {
+        cout << "Unable to open file" << endl;
+        return 0;
+    }
+    std::string line;
+    int line_no = 0;
+    while (std::getline(fin, line)) {
+        line_no++;
+        size_t first = line.find_first_not_of(" \t\r");
+        if (first == std::string::npos || line[first] == '#') {
+            continue;
+        }
+        std::stringstream ss(line);
+        BatchRow row;
+        if (!(ss >> row.constraint >> row.inv >> row.wire >> row.topology
+                 >> row.out1 >> row.out2 >> row.out3 >> row.out4)) {
+            cout << "Malformed manifest line " << line_no << endl;
+            return 0;
+        }
+        rows.push_back(row);
+    }
+    return 1;
+}
+
+// one net, the same steps main goes through for a single one
+static int runNet(const Context& ctx, const BatchRow& row, Arena& arena, long& sinks) {
+    Tree tree(&arena);
+    int ok = parseTree(ctx, row.topology, tree);
+    if (ok) {
+        ok = writePre(ctx, tree, row.out1) && elmoreDelay(ctx, tree, row.out2);
+        if (ok) {
+            int new_root = inverterInsertion(ctx, tree);
+            ok = new_root >= 0 && write3rdOutputPost(ctx, tree, new_root, row.out3, row.out4);
+        }
+        // every non-leaf has two children
+        sinks = (tree.parsed + 1) / 2;
+    }
+    freeMyTree(tree, arena);
+    return ok;
+}
+
+int runBatch(const std::string& manifest, int threads, const Context& base) {
+    std::vector<BatchRow> rows;
+    if (!readManifest(manifest, rows)) {
+        return -1;
+    }
+    auto start = std::chrono::steady_clock::now();
+
+    // parameter files are read once up front, the tasks only look them up
+    std::map<std::string, Context> inv_cache, wire_cache;
+    std::vector<Context> contexts(rows.size());
+    std::vector<char> usable(rows.size(), 1);
+    for (size_t i = 0; i < rows.size(); i++) {
+        const BatchRow& row = rows[i];
+        if (!inv_cache.count(row.inv) && !storeInvParams(row.inv, inv_cache[row.inv])) {
+            inv_cache.erase(row.inv);
+        }
+        if (!wire_cache.count(row.wire) && !storeWireParams(row.wire, wire_cache[row.wire])) {
+            wire_cache.erase(row.wire);
+        }
+        if (!inv_cache.count(row.inv) || !wire_cache.count(row.wire)) {
+            usable[i] = 0;
+            continue;
+        }
+        // the options come from base; only the parameters and the
+        // constraint are the row's own
+        Context& ctx = contexts[i];
+        ctx = base;
+        const Context& wire = wire_cache[row.wire];
+        ctx.unit_wire_res = wire.unit_wire_res;
+        ctx.unit_wire_cap = wire.unit_wire_cap;
+        const Context& inv = inv_cache[row.inv];
+        ctx.inv_input_cap = inv.inv_input_cap;
+        ctx.inv_output_cap = inv.inv_output_cap;
+        ctx.inv_output_res = inv.inv_output_res;
+        ctx.time_constraint = row.constraint;
+    }
+
+    TaskPool pool(threads);
+    // scratch memory per worker, reset after every net
+    std::vector<std::unique_ptr<Arena>> arenas;
+    for (int w = 0; w < pool.size(); w++) {
+        arenas.push_back(std::make_unique<Arena>(false, 4 << 20));
+    }
+
+    std::atomic<long> total_sinks(0);
+    std::atomic<int> failed(0);
+    for (size_t i = 0; i < rows.size(); i++) {
+        if (!usable[i]) {
+            failed++;
+            continue;
+        }
+        pool.spawn([&, i] {
+            long sinks = 0;
+            if (runNet(contexts[i], rows[i], *arenas[pool.worker()], sinks)) {
+                total_sinks += sinks;
+            } else {
+                failed++;
+            }
+        });
+    }
+    pool.wait();
+
+    std::chrono::duration<double> secs = std::chrono::steady_clock::now() - start;
+    long nets = (long) rows.size() - failed;
+    cout << "batch: " << nets << " nets, " << total_sinks << " sinks in " << secs.count() << " s ("
+         << nets / secs.count() << " nets/s, " << total_sinks / secs.count() << " sinks/s)";
+    if (failed > 0) {
+        cout << ", " << failed << " failed";
+    }
+    cout << endl;
+    return failed;
+}
@@ -0,0 +1,20 @@
+#ifndef BATCH_H
+#define BATCH_H
+
+#include <string>
+#include "tree.h"
+
+// Runs every net listed in a manifest, one per line with the same eight
+// fields as the command line:
+//
+//   constraint inv.param wire.param topology out1 out2 out3 out4
+//
+// Blank lines and lines starting with '#' are skipped. Nets run in parallel
+// on threads workers, each with its own arena; a parameter file is read
+// once however many rows name it. Prints a throughput summary and returns
+// the number of nets that failed, or -1 if the manifest cannot be read.
+// Output modes and insertion engine come from base; its parameters and
+// constraint are not used.
+int runBatch(const std::string& manifest, int threads, const Context& base);
+
+#endif
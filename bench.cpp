@@ -0,0 +1,367 @@
+// Compares the iterative tree passes with the recursive versions they
+// replaced, on balanced trees and on chain-shaped (daisy chain) trees. Both
+// sides write through the same writer to /dev/null (a BufferedWriter, or a
+// DelayWriter for the Elmore pass), so only the traversal differs. The
+// downstream capacitances come from the parse on both sides, so the Elmore
+// row times the delay pass.
+//
+// A second table puts the greedy insertion next to the DP engine on the same
+// trees and on the example nets, with the inverter count (drivers included)
+// and the worst Elmore stage delay of each result.
+//
+//   ./pa1_bench [repeats]
+//
+// The recursive versions run on a thread with a 1 GB stack so that deep
+// chains can be timed at all; with the default 8 MB stack they overflow.
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+#include <random>
+#include <chrono>
+#include <functional>
+#include <pthread.h>
+#include "tree.h"
+using namespace std;
+
+// ---- recursive versions, as they were before the iterative rewrite ----
+
+// the lines tree.cpp prints, "label(cap)" and "(left right[ inverter])"
+static void leafLine(BufferedWriter& out, int label, double cap) {
+    out.print(label);
+    out.print('(');
+    out.printSci(cap);
+    out.print(")\n");
+}
+
+static void wireLine(BufferedWriter& out, double left_wire, double right_wire, const char* inverter) {
+    out.print('(');
+    out.printSci(left_wire);
+    out.print(' ');
+    out.printSci(right_wire);
+    out.print(inverter);
+    out.print(")\n");
+}
+
+static void preOrderRecursive(const Tree& tree, int node, BufferedWriter& fout) {
+    if (node < 0) {
+        return;
+    }
+    if (tree.type[node]==LEAF) {
+        leafLine(fout, tree.label[node], tree.capacitance[node]);
+    } else if (tree.type[node]==BRIDGE){
+        wireLine(fout, tree.leftWire[node], tree.rightWire[node], "");
+    }
+    preOrderRecursive(tree, tree.left[node], fout);
+    preOrderRecursive(tree, tree.right[node], fout);
+}
+
+static void delayRecursive(const Context& ctx, Tree& tree, int node, double curr_elmore_delay, double resistance,
+                           DelayWriter& fp) {
+    if (node < 0) {
+        return;
+    }
+    curr_elmore_delay += (resistance * tree.elmore_capacitance[node]);
+    tree.elmore_delay[node] = curr_elmore_delay;
+    if (tree.type[node]==LEAF) {
+        fp.put(tree.label[node], curr_elmore_delay);
+    }
+    delayRecursive(ctx, tree, tree.left[node], curr_elmore_delay, ctx.unit_wire_res * tree.leftWire[node], fp);
+    delayRecursive(ctx, tree, tree.right[node], curr_elmore_delay, ctx.unit_wire_res * tree.rightWire[node], fp);
+}
+
+static int insertionRecursive(const Context& ctx, Tree& tree, int node, double l) {
+    if (node < 0) {
+        return -1;
+    }
+    int temp_left = insertionRecursive(ctx, tree, tree.left[node], tree.leftWire[node]);
+    if (temp_left >= 0 && tree.type[temp_left]==INV) {
+        replaceLeftChild(ctx, tree, node, temp_left);
+    }
+    int temp_right = insertionRecursive(ctx, tree, tree.right[node], tree.rightWire[node]);
+    if (temp_right >= 0 && tree.type[temp_right]==INV) {
+        replaceRightChild(ctx, tree, node, temp_right);
+    }
+    if (temp_left >= 0 && temp_right >= 0) {
+        if (tree.polarity[temp_left] == 0 && tree.polarity[temp_right] == 1) {
+            int inv = addPolarityInverter(ctx, tree, tree.left[node], tree.leftWire[node]);
+            replaceLeftChild(ctx, tree, node, inv);
+            tree.polarity[node] = tree.polarity[inv];
+        } else if (tree.polarity[temp_left] == 1 && tree.polarity[temp_right] == 0) {
+            int inv = addPolarityInverter(ctx, tree, tree.right[node], tree.rightWire[node]);
+            replaceRightChild(ctx, tree, node, inv);
+            tree.polarity[node] = tree.polarity[inv];
+        } else {
+            tree.polarity[node] = tree.polarity[temp_left];
+        }
+    }
+    return inverterSegmentation(ctx, tree, node, l, branchTimeConstraint(ctx, tree, node));
+}
+
+static void output3Recursive(const Tree& tree, int node, BufferedWriter& fout, BufferedWriter& fp) {
+    if (node < 0) {
+        return;
+    }
+    output3Recursive(tree, tree.left[node], fout, fp);
+    output3Recursive(tree, tree.right[node], fout, fp);
+    if (tree.type[node]==LEAF) {
+        leafLine(fout, tree.label[node], tree.capacitance[node]);
+        fp.putInt(tree.label[node]);
+        fp.putDouble(tree.capacitance[node]);
+    } else {
+        int j = tree.type[node]==BRIDGE ? 0 : 1;
+        double rw = tree.type[node]==BRIDGE ? tree.rightWire[node] : -1;
+        fp.putInt(-1);
+        fp.putDouble(tree.leftWire[node]);
+        fp.putDouble(rw);
+        fp.putInt(j);
+        wireLine(fout, tree.leftWire[node], tree.rightWire[node], j ? " 1" : " 0");
+    }
+}
+
+// ---- synthetic trees in the .txt post-order format ----
+
+static void balancedText(std::string& out, int depth, int& label, std::mt19937& rng) {
+    std::uniform_real_distribution<double> wire(1e4, 1e6), cap(1e-14, 5e-14);
+    char line[64];
+    if (depth == 0) {
+        snprintf(line, sizeof(line), "%d(%.10e)\n", ++label, cap(rng));
+        out += line;
+        return;
+    }
+    balancedText(out, depth - 1, label, rng);
+    balancedText(out, depth - 1, label, rng);
+    snprintf(line, sizeof(line), "(%.10e %.10e)\n", wire(rng), wire(rng));
+    out += line;
+}
+
+// every non-leaf has the rest of the chain on its left and one sink on its right
+static std::string chainText(int leaves, std::mt19937& rng) {
+    std::uniform_real_distribution<double> wire(1e3, 1e5), cap(1e-14, 5e-14);
+    std::string out;
+    char line[64];
+    for (int i = 1; i <= leaves; i++) {
+        snprintf(line, sizeof(line), "%d(%.10e)\n", i, cap(rng));
+        out += line;
+        if (i > 1) {
+            snprintf(line, sizeof(line), "(%.10e %.10e)\n", wire(rng), wire(rng));
+            out += line;
+        }
+    }
+    return out;
+}
+
+// ---- timing ----
+
+static double millis(const std::function<void()>& f) {
+    auto start = std::chrono::steady_clock::now();
+    f();
+    std::chrono::duration<double, std::milli> d = std::chrono::steady_clock::now() - start;
+    return d.count();
+}
+
+// runs f on a thread with a big stack, for the recursive versions
+static void onBigStack(const std::function<void()>& f) {
+    pthread_attr_t attr;
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, (size_t) 1 << 30);
+    pthread_t th;
+    auto call = [](void* arg) -> void* {
+        (*static_cast<const std::function<void()>*>(arg))();
+        return nullptr;
+    };
+    pthread_create(&th, &attr, call, const_cast<std::function<void()>*>(&f));
+    pthread_join(th, nullptr);
+    pthread_attr_destroy(&attr);
+}
+
+static void report(const std::string& shape, int nodes, const char* pass, double rec, double iter) {
+    printf("%-16s %10d  %-10s %10.2f %10.2f %8.2fx\n", shape.c_str(), nodes, pass, rec, iter, rec / iter);
+}
+
+static void benchShape(const Context& ctx, const std::string& shape, const std::string& text, int repeats) {
+    Tree parsed;
+    if (!parseTopology(ctx, text.data(), text.data() + text.size(), parsed)) {
+        return;
+    }
+    int n = parsed.parsed;
+
+    double rec = 1e30, iter = 1e30;
+    for (int r = 0; r < repeats; r++) {
+        onBigStack([&] {
+            BufferedWriter fout;
+            fout.open("/dev/null");
+            rec = std::min(rec, millis([&] { preOrderRecursive(parsed, parsed.root, fout); }));
+        });
+        BufferedWriter fout;
+        fout.open("/dev/null");
+        iter = std::min(iter, millis([&] { preOrderTraversal(parsed, fout); }));
+    }
+    report(shape, n, "out1", rec, iter);
+
+    rec = iter = 1e30;
+    for (int r = 0; r < repeats; r++) {
+        onBigStack([&] {
+            DelayWriter fp;
+            fp.open("/dev/null", ctx.io, false);
+            rec = std::min(rec, millis([&] { delayRecursive(ctx, parsed, parsed.root, 0, ctx.inv_output_res, fp); }));
+            fp.close();
+        });
+        DelayWriter fp;
+        fp.open("/dev/null", ctx.io, false);
+        iter = std::min(iter, millis([&] { elmoreDelay(ctx, parsed, fp); }));
+        fp.close();
+    }
+    report(shape, n, "elmore", rec, iter);
+
+    rec = iter = 1e30;
+    Tree inserted;
+    int new_root = -1;
+    for (int r = 0; r < repeats; r++) {
+        Tree a = parsed;
+        onBigStack([&] {
+            rec = std::min(rec, millis([&] { insertionRecursive(ctx, a, a.root, 0); }));
+        });
+        inserted = parsed;
+        iter = std::min(iter, millis([&] { new_root = inverterInsertion(ctx, inserted); }));
+    }
+    report(shape, n, "insertion", rec, iter);
+    if (new_root < 0) {
+        return;
+    }
+
+    rec = iter = 1e30;
+    for (int r = 0; r < repeats; r++) {
+        onBigStack([&] {
+            BufferedWriter fout, fp;
+            fout.open("/dev/null");
+            fp.open("/dev/null");
+            rec = std::min(rec, millis([&] { output3Recursive(inserted, new_root, fout, fp); }));
+        });
+        BufferedWriter fout, fp;
+        fout.open("/dev/null");
+        fp.open("/dev/null");
+        iter = std::min(iter, millis([&] { postOrderTraversalOutput3(inserted, new_root, fout, fp); }));
+    }
+    report(shape, n, "out3", rec, iter);
+}
+
+// ---- result check ----
+
+// Elmore delay of every stage of an inserted tree, drivers included: the
+// largest one and how many are over the constraint
+static void checkStages(const Context& ctx, const Tree& tree, int root, double& worst, int& violations) {
+    worst = 0;
+    violations = 0;
+    auto close = [&](double c, double d) {
+        double delay = ctx.inv_output_res * (ctx.inv_output_cap + c) + d;
+        worst = std::max(worst, delay);
+        violations += delay > ctx.time_constraint * (1 + 1e-9);
+    };
+    // capacitance and worst wire delay seen from the top of each node
+    std::vector<double> cap(tree.size()), delay(tree.size());
+    auto up = [&](int child, double l, double& c, double& d) {
+        c = cap[child] + ctx.unit_wire_cap * l;
+        d = delay[child] + ctx.unit_wire_res * l * (ctx.unit_wire_cap * l / 2 + cap[child]);
+    };
+
+    std::vector<std::pair<int, bool>> st;
+    st.push_back({root, false});
+    while (!st.empty()) {
+        int node = st.back().first;
+        if (!st.back().second) {
+            st.back().second = true;
+            if (tree.right[node] >= 0) st.push_back({tree.right[node], false});
+            if (tree.left[node] >= 0) st.push_back({tree.left[node], false});
+            continue;
+        }
+        st.pop_back();
+
+        if (tree.type[node] == LEAF) {
+            cap[node] = tree.capacitance[node];
+            delay[node] = 0;
+        } else if (tree.type[node] == BRIDGE) {
+            double lc, ld, rc, rd;
+            up(tree.left[node], tree.leftWire[node], lc, ld);
+            up(tree.right[node], tree.rightWire[node], rc, rd);
+            cap[node] = lc + rc;
+            delay[node] = std::max(ld, rd);
+        } else {
+            double c, d;
+            up(tree.left[node], tree.leftWire[node], c, d);
+            close(c, d);
+            cap[node] = ctx.inv_input_cap;
+            delay[node] = 0;
+        }
+    }
+    close(cap[root], delay[root]);
+    if (tree.polarity[root] == 0) {
+        close(ctx.inv_input_cap, 0);
+    }
+}
+
+static void compareEngines(Context ctx, const std::string& shape, const std::string& text) {
+    Tree parsed;
+    if (!parseTopology(ctx, text.data(), text.data() + text.size(), parsed)) {
+        return;
+    }
+    for (InsertionEngine engine : {ENGINE_GREEDY, ENGINE_DP}) {
+        ctx.engine = engine;
+        Tree tree = parsed;
+        int root = -1;
+        double ms = millis([&] { root = inverterInsertion(ctx, tree); });
+        if (root < 0) {
+            continue;
+        }
+        double worst;
+        int violations;
+        checkStages(ctx, tree, root, worst, violations);
+        int inverters = tree.size() - tree.parsed + 1 + (tree.polarity[root] == 0);
+        printf("%-16s %10d  %-6s %10.2f %10d %12.4e %10d\n", shape.c_str(), parsed.parsed,
+               engine == ENGINE_DP ? "dp" : "greedy", ms, inverters, worst, violations);
+    }
+}
+
+int main(int argc, char** argv) {
+    int repeats = argc > 1 ? atoi(argv[1]) : 3;
+
+    // examples/wire.param and examples/inv.param
+    Context ctx;
+    ctx.unit_wire_res = 1.0e-04;
+    ctx.unit_wire_cap = 2.0e-19;
+    ctx.inv_input_cap = 3.45e-14;
+    ctx.inv_output_cap = 5.8e-14;
+    ctx.inv_output_res = 113;
+    ctx.time_constraint = 1e-9;
+
+    printf("%-16s %10s  %-10s %10s %10s %9s\n", "shape", "nodes", "pass", "rec ms", "iter ms", "speedup");
+    std::mt19937 rng(1);
+    for (int depth : {14, 18}) {
+        std::string text;
+        int label = 0;
+        balancedText(text, depth, label, rng);
+        benchShape(ctx, "balanced-2^" + std::to_string(depth), text, repeats);
+    }
+    for (int leaves : {10000, 100000, 1000000}) {
+        benchShape(ctx, "chain-" + std::to_string(leaves), chainText(leaves, rng), repeats);
+    }
+
+    printf("\n%-16s %10s  %-6s %10s %10s %12s %10s\n", "shape", "nodes", "engine", "ms",
+           "inverters", "worst stage", "over");
+    ctx.time_constraint = 3e-10;
+    for (const char* name : {"p1", "s1423", "s5378"}) {
+        std::ifstream in(std::string("examples/") + name + ".txt");
+        std::stringstream text;
+        text << in.rdbuf();
+        compareEngines(ctx, name, text.str());
+    }
+    rng.seed(2);
+    std::string text;
+    int label = 0;
+    balancedText(text, 14, label, rng);
+    compareEngines(ctx, "balanced-2^14", text);
+    compareEngines(ctx, "chain-10000", chainText(10000, rng));
+
+    return 0;
+}
@@ -9,6 +9,9 @@ File format (stream of records):
 
 If a non-leaf node has only a branch, the right-child wire length is -1.0.
 
+A file may start with a 32 byte header: the magic b'BTOPO1\\0\\0' and three
+uint64 counts of leaf, two-branch and one-branch records. It is skipped.
+
 This script reads the file and prints each parsed record in preorder order.
 """
 
@@ -25,6 +28,10 @@ def read_tree_bin_file(path):
               for an internal node: {'type': 'internal', 'left_len': float, 'right_len': float, 'num_inv': int}
     """
     with open(path, 'rb') as f:
+        if f.read(8) == b'BTOPO1\0\0':
+            f.read(24)
+        else:
+            f.seek(0)
         while True:
             int_bytes = f.read(4)
             if not int_bytes:
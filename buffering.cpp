@@ -0,0 +1,370 @@
+// Inverter insertion by dynamic programming over candidate lists (van
+// Ginneken), the alternative to the greedy segmentation in tree.cpp.
+//
+// Every point of the tree carries a list of candidates for the stage that is
+// still open above it:
+//   c  capacitance the stage sees below the point
+//   d  largest wire delay from the point down to a load of the stage
+//   n  inverters used below
+//   p  inverters on every path below, mod 2 (both branches must agree)
+// A candidate can be closed by an inverter at the point if the inverter can
+// drive it within the constraint, R (Co + c) + d <= T. Candidates move up a
+// wire, are merged pairwise at a bridge and are pruned on dominance; at the
+// root the driver closes the cheapest candidate it can drive.
+//
+// Inverters can go at both ends of every wire and at points in between,
+// ctx.dp_points_per_stage of them per longest wire one inverter can drive
+// into another (--dp-points). Over those positions the result is optimal:
+// pruning only drops candidates that another one is at least as good as in
+// c, d and n. Delays are plain Elmore delays of each stage, so the result
+// meets the constraint where the greedy pass underestimates a stage and can
+// need more inverters than the greedy count for that reason.
+#include <algorithm>
+#include <iterator>
+#include <vector>
+#include "tree.h"
+
+namespace {
+
+struct Cand {
+    double c;
+    double d;
+    int n;
+    int p;
+    int trace;
+};
+
+// How a candidate was built, to place the inverters once the root is done.
+// Wires do not get entries: moving up a wire keeps the trace.
+struct Trace {
+    enum Kind : unsigned char { SINK, INVERTER, MERGE } kind;
+    int a;        // INVERTER: trace below; MERGE: left trace
+    int b;        // INVERTER: node whose up-wire holds it; MERGE: right trace
+    double x;     // INVERTER: distance from the bottom of that wire
+};
+
+class BufferingDP {
+public:
+    explicit BufferingDP(const Context& context) : ctx(context) {}
+
+    int run(Tree& tree);
+
+private:
+    const Context& ctx;
+    std::vector<Trace> traces;
+    std::vector<Cand> scratch;
+    // kept candidates of the smaller counts of one polarity, c up and d down
+    std::vector<Cand> stairs, stairs_next;
+
+    double stageDelay(const Cand& k) const {
+        return ctx.inv_output_res * (ctx.inv_output_cap + k.c) + k.d;
+    }
+
+    int addTrace(Trace::Kind kind, int a, int b, double x) {
+        traces.push_back({kind, a, b, x});
+        return (int) traces.size() - 1;
+    }
+
+    void prune(std::vector<Cand>& list);
+    void addInverters(std::vector<Cand>& list, int wire_node, double x);
+    void climbWire(std::vector<Cand>& list, int node, double length, double step);
+    bool merge(const std::vector<Cand>& left, const std::vector<Cand>& right, std::vector<Cand>& out);
+    void place(Tree& tree, int trace, const std::vector<int>& parent);
+    void setPolarity(Tree& tree, int child, std::vector<int>& chain);
+};
+
+// Drops every candidate that another one of the same polarity is no worse
+// than in c, d and n. Sorted by (p, n, c, d), each (p, n) group is pruned in
+// one pass: going up in c, a candidate stays only if its d is below that of
+// the last one kept. The groups of smaller counts of that polarity are kept
+// merged into one staircase, which a binary search checks first.
+// Candidates no inverter can drive never become drivable further up, so
+// they go too, unless nothing else is left.
+void BufferingDP::prune(std::vector<Cand>& list) {
+    size_t feasible = 0;
+    for (const Cand& k : list) {
+        feasible += stageDelay(k) <= ctx.time_constraint;
+    }
+    if (feasible == 0) {
+        // the constraint cannot be met here; go on with the least bad one
+        auto best = std::min_element(list.begin(), list.end(), [&](const Cand& x, const Cand& y) {
+            return stageDelay(x) < stageDelay(y);
+        });
+        Cand keep = *best;
+        list.assign(1, keep);
+        return;
+    }
+
+    std::sort(list.begin(), list.end(), [](const Cand& x, const Cand& y) {
+        if (x.p != y.p) return x.p < y.p;
+        if (x.n != y.n) return x.n < y.n;
+        if (x.c != y.c) return x.c < y.c;
+        return x.d < y.d;
+    });
+
+    auto by_c = [](const Cand& x, const Cand& y) {
+        return x.c < y.c || (x.c == y.c && x.d < y.d);
+    };
+    scratch.clear();
+    for (size_t i = 0; i < list.size(); ) {
+        if (i == 0 || list[i].p != list[i - 1].p) {
+            stairs.clear();
+        }
+        size_t group_start = scratch.size();
+        size_t end = i;
+        for (; end < list.size() && list[end].p == list[i].p && list[end].n == list[i].n; end++) {
+            const Cand& k = list[end];
+            if (stageDelay(k) > ctx.time_constraint) {
+                continue;
+            }
+            if (scratch.size() > group_start && scratch.back().d <= k.d) {
+                continue;
+            }
+            // the smaller count with the largest c not above k.c has the least d of those
+            auto below = std::upper_bound(stairs.begin(), stairs.end(), k, by_c);
+            if (below != stairs.begin() && (below - 1)->d <= k.d) {
+                continue;
+            }
+            scratch.push_back(k);
+        }
+        i = end;
+
+        // fold the group into the staircase
+        stairs_next.clear();
+        std::merge(stairs.begin(), stairs.end(), scratch.begin() + group_start, scratch.end(),
+                   std::back_inserter(stairs_next), by_c);
+        stairs.clear();
+        for (const Cand& k : stairs_next) {
+            if (stairs.empty() || k.d < stairs.back().d) {
+                stairs.push_back(k);
+            }
+        }
+    }
+    list.swap(scratch);
+}
+
+// an inverter at distance x up the wire above wire_node: for each polarity,
+// the cheapest candidate it can drive turns into a new one-inverter load
+void BufferingDP::addInverters(std::vector<Cand>& list, int wire_node, double x) {
+    const Cand* best[2] = {nullptr, nullptr};
+    for (const Cand& k : list) {
+        if (stageDelay(k) <= ctx.time_constraint && (!best[k.p] || k.n < best[k.p]->n)) {
+            best[k.p] = &k;
+        }
+    }
+    Cand added[2];
+    int count = 0;
+    for (int p = 0; p < 2; p++) {
+        if (best[p]) {
+            int trace = addTrace(Trace::INVERTER, best[p]->trace, wire_node, x);
+            added[count++] = {ctx.inv_input_cap, 0, best[p]->n + 1, 1 - p, trace};
+        }
+    }
+    list.insert(list.end(), added, added + count);
+}
+
+// moves the list of node up the wire above it, with inverter positions at
+// both ends and every step in between
+void BufferingDP::climbWire(std::vector<Cand>& list, int node, double length, double step) {
+    addInverters(list, node, 0);
+    prune(list);
+
+    double x = 0;
+    while (x < length) {
+        double next = (step > 0 && length - x > step) ? x + step : length;
+        double seg = next - x;
+        double seg_cap = ctx.unit_wire_cap * seg;
+        for (Cand& k : list) {
+            k.d += ctx.unit_wire_res * seg * (seg_cap / 2 + k.c);
+            k.c += seg_cap;
+        }
+        x = next;
+        addInverters(list, node, x);
+        prune(list);
+    }
+}
+
+// pairs up left and right candidates of the same polarity. Within two
+// fronts of fixed counts (c up, d down) this is the linear van Ginneken
+// merge: always move on from the side that sets d. Returns false if the
+// two sides have no polarity in common.
+bool BufferingDP::merge(const std::vector<Cand>& left, const std::vector<Cand>& right, std::vector<Cand>& out) {
+    out.clear();
+    size_t i = 0;
+    while (i < left.size()) {
+        size_t i_end = i;
+        while (i_end < left.size() && left[i_end].p == left[i].p && left[i_end].n == left[i].n) i_end++;
+
+        size_t j = 0;
+        while (j < right.size()) {
+            size_t j_end = j;
+            while (j_end < right.size() && right[j_end].p == right[j].p && right[j_end].n == right[j].n) j_end++;
+
+            if (left[i].p == right[j].p) {
+                size_t a = i, b = j;
+                while (a < i_end && b < j_end) {
+                    const Cand& l = left[a];
+                    const Cand& r = right[b];
+                    int trace = addTrace(Trace::MERGE, l.trace, r.trace, 0);
+                    out.push_back({l.c + r.c, std::max(l.d, r.d), l.n + r.n, l.p, trace});
+                    if (l.d > r.d) {
+                        a++;
+                    } else if (r.d > l.d) {
+                        b++;
+                    } else {
+                        a++;
+                        b++;
+                    }
+                }
+            }
+            j = j_end;
+        }
+        i = i_end;
+    }
+    if (out.empty()) {
+        // only when no inverter on either wire meets the constraint; joining
+        // them anyway would give the sinks of one side the wrong polarity
+        return false;
+    }
+    // merge traces of candidates pruned here are left behind
+    prune(out);
+    return true;
+}
+
+// Builds the inverters of the chosen candidate into the tree.
+void BufferingDP::place(Tree& tree, int trace, const std::vector<int>& parent) {
+    // (node whose up-wire, distance from its bottom)
+    std::vector<std::pair<int, double>> inverters;
+    std::vector<int> st;
+    st.push_back(trace);
+    while (!st.empty()) {
+        const Trace& t = traces[st.back()];
+        st.pop_back();
+        if (t.kind == Trace::INVERTER) {
+            inverters.push_back({t.b, t.x});
+            st.push_back(t.a);
+        } else if (t.kind == Trace::MERGE) {
+            st.push_back(t.a);
+            st.push_back(t.b);
+        }
+    }
+    std::sort(inverters.begin(), inverters.end());
+
+    for (size_t i = 0; i < inverters.size(); ) {
+        int node = inverters[i].first;
+        int par = parent[node];
+        bool on_left = tree.left[par] == node;
+        double length = on_left ? tree.leftWire[par] : tree.rightWire[par];
+
+        // bottom up along the wire
+        int below = node;
+        double below_x = 0;
+        for (; i < inverters.size() && inverters[i].first == node; i++) {
+            double x = inverters[i].second;
+            int inv = tree.addInverter(ctx.inv_input_cap, 0);
+            tree.leftWire[inv] = x - below_x;
+            tree.rightWire[inv] = -1;
+            tree.left[inv] = below;
+            if (below != node) {
+                tree.cut_wire[below] = x - below_x;
+            }
+            below = inv;
+            below_x = x;
+        }
+        tree.cut_wire[below] = length - below_x;
+        if (on_left) {
+            tree.left[par] = below;
+            tree.leftWire[par] = length - below_x;
+        } else {
+            tree.right[par] = below;
+            tree.rightWire[par] = length - below_x;
+        }
+    }
+}
+
+// polarity up the inverter chain that ends in child; the parsed node at the
+// bottom of it is already done
+void BufferingDP::setPolarity(Tree& tree, int child, std::vector<int>& chain) {
+    chain.clear();
+    while (tree.type[child] == INV) {
+        chain.push_back(child);
+        child = tree.left[child];
+    }
+    int p = tree.polarity[child];
+    for (size_t i = chain.size(); i-- > 0; ) {
+        p = 1 - p;
+        tree.polarity[chain[i]] = p;
+    }
+}
+
+int BufferingDP::run(Tree& tree) {
+    // longest wire an inverter can drive into another inverter
+    double longest = repeatedStageLength(ctx);
+    // a hair short of the full length, so that rounding does not push the
+    // last point of a stage over the constraint
+    double step = longest > 0 ? longest * (1 - 1e-9) / std::max(1, ctx.dp_points_per_stage) : 0;
+
+    std::vector<int> parent(tree.parsed, -1);
+    std::vector<std::vector<Cand>> lists(tree.parsed);
+    std::vector<Cand> merged;
+
+    // children come before their parents, so one forward scan does it
+    for (int node = 0; node < tree.parsed; node++) {
+        if (tree.type[node] == LEAF) {
+            int trace = addTrace(Trace::SINK, node, -1, 0);
+            lists[node].push_back({tree.capacitance[node], 0, 0, 0, trace});
+            continue;
+        }
+        int l = tree.left[node];
+        int r = tree.right[node];
+        parent[l] = node;
+        parent[r] = node;
+        climbWire(lists[l], l, tree.leftWire[node], step);
+        climbWire(lists[r], r, tree.rightWire[node], step);
+        if (!merge(lists[l], lists[r], merged)) {
+            return -1;
+        }
+        lists[node].swap(merged);
+        std::vector<Cand>().swap(lists[l]);
+        std::vector<Cand>().swap(lists[r]);
+    }
+
+    // the driver closes the last stage and adds one more inverter when the
+    // sinks would otherwise come out inverted
+    const std::vector<Cand>& top = lists[tree.root];
+    const Cand* best = &top[0];
+    for (const Cand& k : top) {
+        bool fits = stageDelay(k) <= ctx.time_constraint;
+        bool best_fits = stageDelay(*best) <= ctx.time_constraint;
+        if (fits != best_fits) {
+            if (fits) best = &k;
+            continue;
+        }
+        int total = k.n + (k.p == 0);
+        int best_total = best->n + (best->p == 0);
+        if (total < best_total || (total == best_total && stageDelay(k) < stageDelay(*best))) {
+            best = &k;
+        }
+    }
+
+    place(tree, best->trace, parent);
+
+    std::vector<int> chain;
+    for (int node = 0; node < tree.parsed; node++) {
+        if (tree.type[node] == LEAF) {
+            tree.polarity[node] = 0;
+            continue;
+        }
+        setPolarity(tree, tree.left[node], chain);
+        setPolarity(tree, tree.right[node], chain);
+        tree.polarity[node] = tree.polarity[tree.left[node]];
+    }
+    return tree.root;
+}
+
+}  // namespace
+
+int inverterInsertionDP(const Context& ctx, Tree& tree) {
+    BufferingDP dp(ctx);
+    return dp.run(tree);
+}
@@ -0,0 +1,136 @@
+#include "ctopo.h"
+#include <iostream>
+using namespace std;
+
+const char ctopo_magic[8] = {'P', 'A', '1', 'C', 'T', 'O', 'P', '1'};
+
+// Fills one block at a time and hands it to the file when it is full.
+struct CtopoEncoder {
+    BufferedWriter& out;
+    std::vector<char> block;
+    uint32_t records = 0;
+    CtopoRegisters reg;
+    bool failed = false;
+
+    explicit CtopoEncoder(BufferedWriter& o) : out(o) {
+        block.reserve(ctopo_block_records * 8);
+    }
+
+    void putValue(double v, int& exponent) {
+        int64_t m;
+        int e;
+        if (!encodeDecimal(v, m, e)) {
+            failed = true;
+            return;
+        }
+        putVarint(block, zigzag(e - exponent));
+        putVarint(block, zigzag(m));
+        exponent = e;
+    }
+
+    // the tag goes in first; flags are or-ed into it as they are found
+    size_t startRecord(int kind) {
+        block.push_back((char) kind);
+        return block.size() - 1;
+    }
+
+    void sink(int label, double cap) {
+        size_t tag = startRecord(CTOPO_SINK);
+        if (label == reg.label + 1) {
+            block[tag] |= ctopo_next_label;
+        } else {
+            putVarint(block, zigzag((int64_t) label - reg.label));
+        }
+        reg.label = label;
+        if (sameValue(cap, reg.cap)) {
+            block[tag] |= ctopo_same_first;
+        } else {
+            putValue(cap, reg.cap_exponent);
+            reg.cap = cap;
+        }
+        endRecord();
+    }
+
+    // right_wire is ignored for an inverter
+    void wires(int kind, double left_wire, double right_wire) {
+        size_t tag = startRecord(kind);
+        if (sameValue(left_wire, reg.wire)) {
+            block[tag] |= ctopo_same_first;
+        } else {
+            putValue(left_wire, reg.wire_exponent);
+            reg.wire = left_wire;
+        }
+        if (kind == CTOPO_BRIDGE) {
+            if (sameValue(right_wire, reg.wire)) {
+                block[tag] |= ctopo_same_second;
+            } else {
+                putValue(right_wire, reg.wire_exponent);
+                reg.wire = right_wire;
+            }
+        }
+        endRecord();
+    }
+
+    void endRecord() {
+        if (++records == ctopo_block_records) {
+            flush();
+        }
+    }
+
+    void flush() {
+        if (records == 0) {
+            return;
+        }
+        uint32_t head[2] = {records, (uint32_t) block.size()};
+        out.put(head, sizeof(head));
+        out.put(block.data(), block.size());
+        block.clear();
+        records = 0;
+        reg = CtopoRegisters();
+    }
+};
+
+int writeCompactTopology(const Context& ctx, const Tree& tree, int root, const std::string& filename) {
+    if (tree.shared()) {
+        cout << "Shared trees cannot be written as a compact topology" << endl;
+        return 0;
+    }
+    BufferedWriter out;
+    if (!out.open(filename, ctx.io)) {
+        cout << "Unable to open file." << endl;
+        return 0;
+    }
+
+    CtopoHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, ctopo_magic, sizeof(h.magic));
+    h.block_records = ctopo_block_records;
+    walkPostOrder(tree, root, [&](int node) {
+        if (tree.type[node] == LEAF) {
+            h.sinks++;
+        } else if (tree.type[node] == BRIDGE) {
+            h.bridges++;
+        } else {
+            h.inverters++;
+        }
+    });
+    out.put(&h, sizeof(h));
+
+    CtopoEncoder enc(out);
+    walkPostOrder(tree, root, [&](int node) {
+        if (tree.type[node] == LEAF) {
+            enc.sink(tree.label[node], tree.capacitance[node]);
+        } else if (tree.type[node] == BRIDGE) {
+            enc.wires(CTOPO_BRIDGE, tree.leftWire[node], tree.rightWire[node]);
+        } else {
+            enc.wires(CTOPO_INVERTER, tree.leftWire[node], 0);
+        }
+    });
+    enc.flush();
+    if (enc.failed) {
+        out.close();
+        cout << "The tree has a value that is not a number" << endl;
+        return 0;
+    }
+    return out.close();
+}
@@ -0,0 +1,176 @@
+#ifndef CTOPO_H
+#define CTOPO_H
+
+#include <charconv>
+#include <cstdint>
+#include <cstring>
+#include <string>
+#include <utility>
+#include <vector>
+#include "tree.h"
+
+// Compact topology (.ctopo): the records of a binary topology, in the
+// same post-order, packed into independent blocks. Nothing is entropy
+// coded: a record is short because it leaves out what the records before
+// it already say and keeps the rest as small varints.
+//
+//   CtopoHeader, then per block: uint32 records, uint32 bytes, the records
+//
+// A record is a tag byte and what the tag does not already say:
+//
+//   tag bits 0-1   CTOPO_SINK, CTOPO_BRIDGE or CTOPO_INVERTER (one wire
+//                  over the subtree before it, as in out4)
+//   tag bit 2      first value equals the previous one of its kind
+//   tag bit 3      right wire equals the wire before it
+//   tag bit 4      sink label is the previous label plus one
+//   then           label (zigzag varint of the change), and every value
+//                  not repeated as two zigzag varints: the change of its
+//                  decimal exponent and its decimal mantissa
+//
+// A value is kept as its shortest decimal form, the one that reads back to
+// the same double, so nothing is lost; a value from the %.10e text costs at
+// most its 11 digits. Capacitances and wires each have their own previous
+// value and exponent. All of that starts over in every block, so a block
+// can be decoded without the ones before it.
+
+struct CtopoHeader {
+    char magic[8];          // "PA1CTOP1"
+    uint64_t sinks;
+    uint64_t bridges;
+    uint64_t inverters;
+    uint32_t block_records;
+    uint32_t unused;
+};
+
+enum CtopoKind {
+    CTOPO_SINK,
+    CTOPO_BRIDGE,
+    CTOPO_INVERTER
+};
+
+const int ctopo_same_first = 1 << 2;
+const int ctopo_same_second = 1 << 3;
+const int ctopo_next_label = 1 << 4;
+const uint32_t ctopo_block_records = 1 << 16;
+
+extern const char ctopo_magic[8];
+
+// what the previous records left behind, cleared at every block
+struct CtopoRegisters {
+    double cap = 0;
+    double wire = 0;
+    int cap_exponent = 0;
+    int wire_exponent = 0;
+    int label = 0;
+};
+
+// equal down to the sign of a zero, so a repeat decodes to the same bits
+inline bool sameValue(double a, double b) {
+    return memcmp(&a, &b, sizeof(double)) == 0;
+}
+
+inline uint64_t zigzag(int64_t v) {
+    return ((uint64_t) v << 1) ^ (uint64_t) (v >> 63);
+}
+
+inline int64_t unzigzag(uint64_t v) {
+    return (int64_t) (v >> 1) ^ -(int64_t) (v & 1);
+}
+
+inline void putVarint(std::vector<char>& out, uint64_t v) {
+    while (v >= 0x80) {
+        out.push_back((char) (v | 0x80));
+        v >>= 7;
+    }
+    out.push_back((char) v);
+}
+
+// returns 0 if the varint runs past end
+inline int getVarint(const char*& p, const char* end, uint64_t& v) {
+    v = 0;
+    for (int shift = 0; p < end && shift < 64; shift += 7) {
+        uint8_t b = (uint8_t) *p++;
+        v |= (uint64_t) (b & 0x7f) << shift;
+        if (b < 0x80) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+// |v| = digits * 10^exponent with the fewest digits that read back as v;
+// mantissa is digits, or -1 - digits when v is negative (so -0 keeps its
+// sign). Returns 0 for inf and nan
+inline int encodeDecimal(double v, int64_t& mantissa, int& exponent) {
+    char buf[40];
+    auto r = std::to_chars(buf, buf + sizeof(buf), v, std::chars_format::scientific);
+    const char* p = buf;
+    bool negative = *p == '-';
+    if (negative) p++;
+    if (*p < '0' || *p > '9') {
+        return 0;
+    }
+    int64_t m = 0;
+    int fraction = 0;
+    bool dot = false;
+    for (; p < r.ptr && *p != 'e'; p++) {
+        if (*p == '.') {
+            dot = true;
+            continue;
+        }
+        m = m * 10 + (*p - '0');
+        fraction += dot;
+    }
+    int e = 0;
+    std::from_chars(p + 1 + (p[1] == '+'), r.ptr, e);
+    mantissa = negative ? -1 - m : m;
+    exponent = e - fraction;
+    return 1;
+}
+
+// exact inverse of encodeDecimal
+inline double decodeDecimal(int64_t mantissa, int exponent) {
+    static const double powers[] = {1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+                                    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+    bool negative = mantissa < 0;
+    uint64_t digits = negative ? (uint64_t) (-1 - mantissa) : (uint64_t) mantissa;
+    double v = 0;
+    if (digits < (1ULL << 53) && exponent >= -22 && exponent <= 22) {
+        // both operands are exact, so one rounding gives the right double
+        v = exponent >= 0 ? (double) digits * powers[exponent] : (double) digits / powers[-exponent];
+    } else {
+        // at most 20 digits, 'e' and an exponent of at most 5 characters
+        char buf[32];
+        char* p = std::to_chars(buf, buf + 20, digits).ptr;
+        p[0] = 'e';
+        p = std::to_chars(p + 1, buf + sizeof(buf), exponent).ptr;
+        std::from_chars(buf, p, v);
+    }
+    return negative ? -v : v;
+}
+
+// post-order over the tree below root (children before parents, left
+// before right), the order of out4 and of the records
+template <class Visit>
+void walkPostOrder(const Tree& tree, int root, Visit visit) {
+    // (node, children already pushed)
+    std::vector<std::pair<int, bool>> st;
+    st.push_back({root, false});
+    while (!st.empty()) {
+        int node = st.back().first;
+        if (!st.back().second) {
+            st.back().second = true;
+            if (tree.right[node] >= 0) st.push_back({tree.right[node], false});
+            if (tree.left[node] >= 0) st.push_back({tree.left[node], false});
+            continue;
+        }
+        st.pop_back();
+        visit(node);
+    }
+}
+
+// Writes the tree below root as a compact topology, inverters included.
+// Shared trees are not supported. Returns 0 if the file cannot be written.
+int writeCompactTopology(const Context& ctx, const Tree& tree, int root, const std::string& filename);
+
+#endif
@@ -0,0 +1,155 @@
+// Converts topologies to and from the compact format (ctopo.h).
+//
+//   ./pa1_ctopo IN OUT             any topology pa1 reads -> compact
+//   ./pa1_ctopo --decode IN OUT    any topology -> post-order text
+//   ./pa1_ctopo --compare IN       the same net as text, binary (with the
+//                                  header) and compact: file size and
+//                                  parseTree time of each
+//
+// Inverters in a binary input are taken out while parsing, as pa1 does.
+// Text comes out the way pa1_gentree writes it, so a generated net goes
+// through the compact format and back byte for byte.
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "ctopo.h"
+#include "tree.h"
+using namespace std;
+
+static int writeText(const Tree& tree, const std::string& filename) {
+    BufferedWriter out;
+    if (!out.open(filename)) {
+        cout << "Unable to open file." << endl;
+        return 0;
+    }
+    walkPostOrder(tree, tree.root, [&](int node) {
+        if (tree.type[node] == LEAF) {
+            out.print(tree.label[node]);
+            out.print('(');
+            out.printSci(tree.capacitance[node], 10);
+            out.print(")\n");
+        } else {
+            out.print('(');
+            out.printSci(tree.leftWire[node], 10);
+            out.print(' ');
+            out.printSci(tree.rightWire[node], 10);
+            out.print(")\n");
+        }
+    });
+    return out.close();
+}
+
+// with the BtopoHeader, so the parse can size the tree from it
+static int writeBinary(const Tree& tree, const std::string& filename) {
+    BufferedWriter out;
+    if (!out.open(filename)) {
+        cout << "Unable to open file." << endl;
+        return 0;
+    }
+    BtopoHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, "BTOPO1\0\0", sizeof(h.magic));
+    walkPostOrder(tree, tree.root, [&](int node) {
+        (tree.type[node] == LEAF ? h.sinks : h.bridges)++;
+    });
+    out.put(&h, sizeof(h));
+    walkPostOrder(tree, tree.root, [&](int node) {
+        if (tree.type[node] == LEAF) {
+            out.putInt(tree.label[node]);
+            out.put(&tree.capacitance[node], sizeof(double));
+        } else {
+            out.putInt(-1);
+            out.put(&tree.leftWire[node], sizeof(double));
+            out.put(&tree.rightWire[node], sizeof(double));
+            out.putInt(0);
+        }
+    });
+    return out.close();
+}
+
+static long fileSize(const std::string& filename) {
+    struct stat st;
+    return stat(filename.c_str(), &st) == 0 ? (long) st.st_size : 0;
+}
+
+// fastest of three parses, in seconds; -1 if the file does not parse
+static double timeParse(const Context& ctx, const std::string& filename, int& nodes) {
+    double best = -1;
+    for (int k = 0; k < 3; k++) {
+        Arena arena;
+        Tree tree(&arena);
+        auto start = chrono::steady_clock::now();
+        if (!parseTree(ctx, filename, tree)) {
+            return -1;
+        }
+        double secs = chrono::duration<double>(chrono::steady_clock::now() - start).count();
+        best = (best < 0 || secs < best) ? secs : best;
+        nodes = tree.parsed;
+        freeMyTree(tree, arena);
+    }
+    return best;
+}
+
+static int compare(const Context& ctx, const Tree& tree, const std::string& input) {
+    std::string base = "/tmp/pa1_ctopo." + std::to_string(getpid());
+    std::string btopo = base + ".btopo", ctopo = base + ".ctopo";
+    if (!writeBinary(tree, btopo) || !writeCompactTopology(ctx, tree, tree.root, ctopo)) {
+        return 1;
+    }
+
+    struct Format {
+        const char* name;
+        std::string file;
+    };
+    Format formats[] = {{"input", input}, {"btopo", btopo}, {"ctopo", ctopo}};
+    long input_size = fileSize(input);
+    printf("%-6s %12s %7s %9s %9s\n", "format", "bytes", "ratio", "MB/s", "ns/node");
+    int ok = 1;
+    for (const Format& f : formats) {
+        int nodes = 0;
+        double secs = timeParse(ctx, f.file, nodes);
+        if (secs < 0) {
+            ok = 0;
+            continue;
+        }
+        long size = fileSize(f.file);
+        printf("%-6s %12ld %7.3f %9.1f %9.1f\n", f.name, size, (double) size / input_size, size / secs / 1e6,
+               secs * 1e9 / nodes);
+    }
+    unlink(btopo.c_str());
+    unlink(ctopo.c_str());
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char** argv) {
+    std::string mode;
+    int a = 1;
+    if (a < argc && (strcmp(argv[a], "--decode") == 0 || strcmp(argv[a], "--compare") == 0)) {
+        mode = argv[a++];
+    }
+    int files = mode == "--compare" ? 1 : 2;
+    if (argc - a != files) {
+        printf("Usage: %s IN OUT\n       %s --decode IN OUT\n       %s --compare IN\n", argv[0], argv[0],
+               argv[0]);
+        return 2;
+    }
+
+    Context ctx;
+    Arena arena;
+    Tree tree(&arena);
+    if (!parseTree(ctx, argv[a], tree)) {
+        return 1;
+    }
+    if (mode == "--compare") {
+        return compare(ctx, tree, argv[a]);
+    }
+    if (mode == "--decode") {
+        return writeText(tree, argv[a + 1]) ? 0 : 1;
+    }
+    return writeCompactTopology(ctx, tree, tree.root, argv[a + 1]) ? 0 : 1;
+}
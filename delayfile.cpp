@@ -0,0 +1,235 @@
+#include "delayfile.h"
+#include <algorithm>
+#include <cstring>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace std;
+
+static const char delay_magic[8] = {'P', 'A', '1', 'D', 'L', 'Y', '1', 0};
+static const size_t plain_record = sizeof(int) + sizeof(double);
+
+static size_t align8(size_t n) {
+    return (n + 7) & ~(size_t) 7;
+}
+
+// label index, slowest sinks and the delay range of n records
+static void buildSections(const DelayRecord* records, size_t n, std::vector<uint32_t>& by_label,
+                          std::vector<uint32_t>& slowest, double& min_delay, double& max_delay) {
+    by_label.resize(n);
+    for (size_t i = 0; i < n; i++) {
+        by_label[i] = (uint32_t) i;
+    }
+    slowest = by_label;
+
+    std::stable_sort(by_label.begin(), by_label.end(), [&](uint32_t a, uint32_t b) {
+        return records[a].label < records[b].label;
+    });
+
+    size_t k = std::min(n, (size_t) delay_slowest_count);
+    std::partial_sort(slowest.begin(), slowest.begin() + k, slowest.end(), [&](uint32_t a, uint32_t b) {
+        if (records[a].delay != records[b].delay) return records[a].delay > records[b].delay;
+        return a < b;
+    });
+    slowest.resize(k);
+
+    min_delay = max_delay = 0;
+    for (size_t i = 0; i < n; i++) {
+        if (i == 0 || records[i].delay < min_delay) min_delay = records[i].delay;
+        if (i == 0 || records[i].delay > max_delay) max_delay = records[i].delay;
+    }
+}
+
+DelayWriter::~DelayWriter() {
+    close();
+}
+
+int DelayWriter::open(const std::string& filename, IoMode io, bool index, bool async) {
+    indexed = index;
+    records.clear();
+    status = 1;
+    if (!out.open(filename, io)) {
+        return 0;
+    }
+    is_open = true;
+    if (async) {
+        queue = std::make_unique<BoundedQueue<std::vector<DelayRecord>>>(delay_queue_chunks);
+        chunk.reserve(delay_chunk_records);
+        worker = std::thread([this] {
+            std::vector<DelayRecord> c;
+            while (queue->pop(c)) {
+                for (const DelayRecord& r : c) {
+                    store(r.label, r.delay);
+                }
+            }
+            status = finish();
+        });
+    }
+    return 1;
+}
+
+void DelayWriter::store(int label, double delay) {
+    if (indexed) {
+        records.push_back({label, 0, delay});
+        return;
+    }
+    // the layout of the separate fwrites out2 used to be written with
+    char rec[plain_record];
+    memcpy(rec, &label, sizeof(int));
+    memcpy(rec + sizeof(int), &delay, sizeof(double));
+    out.put(rec, sizeof(rec));
+}
+
+int DelayWriter::close() {
+    if (!is_open) {
+        return 1;
+    }
+    is_open = false;
+    if (!queue) {
+        return finish();
+    }
+    if (!chunk.empty()) {
+        queue->push(std::move(chunk));
+    }
+    chunk = std::vector<DelayRecord>();
+    queue->close();
+    worker.join();
+    queue.reset();
+    return status;
+}
+
+int DelayWriter::finish() {
+    if (indexed) {
+        std::vector<uint32_t> by_label, slowest;
+        DelayFileHeader h;
+        memset(&h, 0, sizeof(h));
+        memcpy(h.magic, delay_magic, sizeof(h.magic));
+        buildSections(records.data(), records.size(), by_label, slowest, h.min_delay, h.max_delay);
+        h.sinks = records.size();
+        h.slowest_count = slowest.size();
+        h.records = sizeof(h);
+        h.by_label = h.records + records.size() * sizeof(DelayRecord);
+        h.slowest = align8(h.by_label + by_label.size() * sizeof(uint32_t));
+
+        const char zeros[8] = {};
+        out.put(&h, sizeof(h));
+        out.put(records.data(), records.size() * sizeof(DelayRecord));
+        out.put(by_label.data(), by_label.size() * sizeof(uint32_t));
+        out.put(zeros, h.slowest - (h.by_label + by_label.size() * sizeof(uint32_t)));
+        out.put(slowest.data(), slowest.size() * sizeof(uint32_t));
+        std::vector<DelayRecord>().swap(records);
+    }
+    return out.close();
+}
+
+DelayFile::~DelayFile() {
+    if (map) {
+        munmap(map, map_size);
+    }
+}
+
+// does a section of n elements at offset lie inside the file, aligned for them
+static bool sectionFits(uint64_t offset, uint64_t n, size_t element, size_t size) {
+    return offset <= size && offset % alignof(double) == 0 && n <= (size - offset) / element;
+}
+
+int DelayFile::open(const std::string& filename) {
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        cout << "Unable to open file" << endl;
+        return 0;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0) {
+        ::close(fd);
+        return 0;
+    }
+    size_t size = st.st_size;
+
+    char magic[sizeof(delay_magic)] = {};
+    if (size >= sizeof(DelayFileHeader) && pread(fd, magic, sizeof(magic), 0) == (ssize_t) sizeof(magic) &&
+        memcmp(magic, delay_magic, sizeof(magic)) == 0) {
+        void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        ::close(fd);
+        if (p == MAP_FAILED) {
+            return 0;
+        }
+        map = p;
+        map_size = size;
+
+        const char* base = static_cast<const char*>(p);
+        const DelayFileHeader* h = reinterpret_cast<const DelayFileHeader*>(base);
+        // the counts come from the file, so the section ends are checked
+        // without multiplying them out
+        if (!sectionFits(h->records, h->sinks, sizeof(DelayRecord), size) ||
+            !sectionFits(h->by_label, h->sinks, sizeof(uint32_t), size) ||
+            !sectionFits(h->slowest, h->slowest_count, sizeof(uint32_t), size)) {
+            cout << "Delay file is cut short" << endl;
+            return 0;
+        }
+        if (h->slowest_count > h->sinks || h->sinks > UINT32_MAX) {
+            cout << "Delay file is corrupt" << endl;
+            return 0;
+        }
+        records = reinterpret_cast<const DelayRecord*>(base + h->records);
+        by_label = reinterpret_cast<const uint32_t*>(base + h->by_label);
+        slowest_list = reinterpret_cast<const uint32_t*>(base + h->slowest);
+        count = h->sinks;
+        slowest_count = h->slowest_count;
+        min_delay = h->min_delay;
+        max_delay = h->max_delay;
+        // both index sections point into the records
+        for (size_t i = 0; i < count; i++) {
+            if (by_label[i] >= count) {
+                cout << "Delay file is corrupt" << endl;
+                return 0;
+            }
+        }
+        for (size_t k = 0; k < slowest_count; k++) {
+            if (slowest_list[k] >= count) {
+                cout << "Delay file is corrupt" << endl;
+                return 0;
+            }
+        }
+        return 1;
+    }
+
+    // plain: read it all and build the sections here
+    if (size % plain_record != 0) {
+        cout << "Not a delay file" << endl;
+        ::close(fd);
+        return 0;
+    }
+    std::vector<char> data(size);
+    ssize_t got = size > 0 ? pread(fd, data.data(), size, 0) : 0;
+    ::close(fd);
+    if (got != (ssize_t) size) {
+        return 0;
+    }
+    count = size / plain_record;
+    own_records.resize(count);
+    for (size_t i = 0; i < count; i++) {
+        int label;
+        memcpy(&label, &data[i * plain_record], sizeof(int));
+        own_records[i].label = label;
+        memcpy(&own_records[i].delay, &data[i * plain_record + sizeof(int)], sizeof(double));
+    }
+    buildSections(own_records.data(), count, own_by_label, own_slowest, min_delay, max_delay);
+    records = own_records.data();
+    by_label = own_by_label.data();
+    slowest_list = own_slowest.data();
+    slowest_count = own_slowest.size();
+    return 1;
+}
+
+long DelayFile::find(int label) const {
+    const uint32_t* it = std::lower_bound(by_label, by_label + count, label, [&](uint32_t pos, int l) {
+        return records[pos].label < l;
+    });
+    if (it == by_label + count || records[*it].label != label) {
+        return -1;
+    }
+    return *it;
+}
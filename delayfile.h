@@ -0,0 +1,150 @@
+#ifndef DELAYFILE_H
+#define DELAYFILE_H
+
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+#include "taskpool.h"
+#include "writer.h"
+
+// out2 comes in two layouts:
+//   plain    (int label, double delay) per sink, packed, in pre-order
+//   indexed  a header, the same records padded to 16 bytes, the record
+//            positions sorted by label, and the slowest sinks first
+// Every section of the indexed one starts 8-byte aligned, so a reader can
+// use the file straight from an mmap.
+
+struct DelayFileHeader {
+    char magic[8];          // "PA1DLY1" and a zero byte
+    uint64_t sinks;
+    uint64_t slowest_count;
+    uint64_t records;       // file offsets of the sections
+    uint64_t by_label;
+    uint64_t slowest;
+    double min_delay;       // skew is max_delay - min_delay
+    double max_delay;
+};
+
+struct DelayRecord {
+    int32_t label;
+    int32_t unused;
+    double delay;
+};
+
+// how many of the slowest sinks the indexed layout lists
+const int delay_slowest_count = 100;
+
+// Writes out2 in either layout. Plain records go straight to the file;
+// indexed ones are kept until close, which sorts them and writes it all.
+// With async, put only collects the records; they go in chunks through a
+// bounded queue to a thread of the writer's own, which does all the rest,
+// so the caller can get on with its next stage until close.
+class DelayWriter {
+public:
+    DelayWriter() = default;
+    ~DelayWriter();
+
+    DelayWriter(const DelayWriter&) = delete;
+    DelayWriter& operator=(const DelayWriter&) = delete;
+
+    int open(const std::string& filename, IoMode io, bool indexed, bool async = false);
+    void put(int label, double delay) {
+        if (!queue) {
+            store(label, delay);
+            return;
+        }
+        chunk.push_back({label, 0, delay});
+        if (chunk.size() == delay_chunk_records) {
+            queue->push(std::move(chunk));
+            chunk.clear();
+            chunk.reserve(delay_chunk_records);
+        }
+    }
+    // returns 0 if any write failed; does nothing if the writer is not open
+    int close();
+
+private:
+    static const size_t delay_chunk_records = 1 << 16;
+    static const size_t delay_queue_chunks = 16;
+
+    BufferedWriter out;
+    bool is_open = false;
+    bool indexed = false;
+    std::vector<DelayRecord> records;
+
+    // async only
+    std::unique_ptr<BoundedQueue<std::vector<DelayRecord>>> queue;
+    std::vector<DelayRecord> chunk;
+    std::thread worker;
+    int status = 1;
+
+    void store(int label, double delay);
+    int finish();
+};
+
+// Reads out2 in either layout. An indexed file is used in place from the
+// mapping; a plain one is read and indexed in memory.
+class DelayFile {
+public:
+    DelayFile() = default;
+    ~DelayFile();
+
+    DelayFile(const DelayFile&) = delete;
+    DelayFile& operator=(const DelayFile&) = delete;
+
+    // returns 0 if the file cannot be read or is not a delay file
+    int open(const std::string& filename);
+
+    size_t size() const {
+        return count;
+    }
+
+    // i-th sink in pre-order
+    const DelayRecord& operator[](size_t i) const {
+        return records[i];
+    }
+
+    // position of the sink with this label, -1 if there is none
+    long find(int label) const;
+
+    size_t slowestCount() const {
+        return slowest_count;
+    }
+
+    // position of the k-th slowest sink
+    size_t slowest(size_t k) const {
+        return slowest_list[k];
+    }
+
+    double minDelay() const {
+        return min_delay;
+    }
+
+    double maxDelay() const {
+        return max_delay;
+    }
+
+    bool indexed() const {
+        return map != nullptr;
+    }
+
+private:
+    void* map = nullptr;
+    size_t map_size = 0;
+
+    const DelayRecord* records = nullptr;
+    const uint32_t* by_label = nullptr;
+    const uint32_t* slowest_list = nullptr;
+    size_t count = 0;
+    size_t slowest_count = 0;
+    double min_delay = 0;
+    double max_delay = 0;
+
+    // the sections of a plain file
+    std::vector<DelayRecord> own_records;
+    std::vector<uint32_t> own_by_label, own_slowest;
+};
+
+#endif
@@ -0,0 +1,196 @@
+#include "eco.h"
+#include "instrument.h"
+#include <iostream>
+#include <fstream>
+#include <sstream>
+using namespace std;
+
+EcoSession::EcoSession(const Context& context, Tree& t)
+    : ctx(context), tree(t), parent(t.parsed, -1), pending(t.parsed, 0) {
+    for (int node = 0; node < tree.parsed; node++) {
+        if (tree.type[node] == BRIDGE) {
+            parent[tree.left[node]] = node;
+            parent[tree.right[node]] = node;
+        }
+    }
+}
+
+int EcoSession::checkNode(int node, NodeType type) const {
+    if (tree.shared()) {
+        cout << "ECO edits need a tree without shared subtrees" << endl;
+        return 0;
+    }
+    if (tree.size() != tree.parsed) {
+        cout << "ECO edits need the tree before inverter insertion" << endl;
+        return 0;
+    }
+    if (node < 0 || node >= tree.parsed) {
+        cout << "No node " << node << endl;
+        return 0;
+    }
+    if (tree.type[node] != type) {
+        cout << "Node " << node << (type == LEAF ? " is not a sink" : " is a sink") << endl;
+        return 0;
+    }
+    return 1;
+}
+
+// adds cap to the downstream capacitance of node and everything above it
+void EcoSession::addCapacitance(int node, double cap) {
+    for (int i = node; i >= 0; i = parent[i]) {
+        tree.elmore_capacitance[i] += cap;
+    }
+}
+
+// Recomputes the delays from the root down to node. Shifts waiting on the
+// path are settled first; the subtrees hanging off it get what their top
+// moved by as a new shift.
+void EcoSession::retimePath(int node) {
+    path.clear();
+    for (int i = node; i >= 0; i = parent[i]) {
+        path.push_back(i);
+    }
+
+    double delay = 0;
+    for (size_t k = path.size(); k-- > 0; ) {
+        int i = path[k];
+        double old_delay = tree.elmore_delay[i] + pending[i];
+        if (tree.type[i] == BRIDGE) {
+            pending[tree.left[i]] += pending[i];
+            pending[tree.right[i]] += pending[i];
+        }
+        pending[i] = 0;
+
+        if (i == tree.root) {
+            delay = ctx.inv_output_res * tree.elmore_capacitance[i];
+        } else {
+            int p = parent[i];
+            double wire = (tree.left[p] == i) ? tree.leftWire[p] : tree.rightWire[p];
+            delay += ctx.unit_wire_res * wire * tree.elmore_capacitance[i];
+        }
+        tree.elmore_delay[i] = delay;
+
+        if (tree.type[i] == BRIDGE) {
+            // a child off the path keeps its own wire term, so its whole
+            // subtree moves with i
+            int next = (k > 0) ? path[k - 1] : -1;
+            if (tree.left[i] != next) pending[tree.left[i]] += delay - old_delay;
+            if (tree.right[i] != next) pending[tree.right[i]] += delay - old_delay;
+        }
+    }
+}
+
+int EcoSession::setWire(int node, double left_wire, double right_wire) {
+    if (!checkNode(node, BRIDGE)) {
+        return 0;
+    }
+    if (left_wire < 0 || right_wire < 0) {
+        cout << "Wire length below zero for node " << node << endl;
+        return 0;
+    }
+
+    int kids[2] = {tree.left[node], tree.right[node]};
+    double* wires[2] = {&tree.leftWire[node], &tree.rightWire[node]};
+    double lengths[2] = {left_wire, right_wire};
+    for (int s = 0; s < 2; s++) {
+        // half of the wire cap sits at each end
+        double half = ctx.unit_wire_cap * (lengths[s] - *wires[s]) / 2;
+        *wires[s] = lengths[s];
+        tree.total_capacitance[kids[s]] += half;
+        tree.total_capacitance[node] += half;
+        tree.elmore_capacitance[kids[s]] += half;
+        addCapacitance(node, 2 * half);
+    }
+    retimePath(kids[0]);
+    retimePath(kids[1]);
+    return 1;
+}
+
+int EcoSession::setSinkCap(int node, double cap) {
+    if (!checkNode(node, LEAF)) {
+        return 0;
+    }
+    double change = cap - tree.capacitance[node];
+    tree.capacitance[node] = cap;
+    tree.total_capacitance[node] += change;
+    addCapacitance(node, change);
+    retimePath(node);
+    return 1;
+}
+
+double EcoSession::delay(int node) const {
+    double d = tree.elmore_delay[node];
+    for (int i = node; i >= 0; i = parent[i]) {
+        d += pending[i];
+    }
+    return d;
+}
+
+int EcoSession::commit(const std::string& filename) {
+    PA1_PHASE("eco_commit");
+    // parents come after their children, so a backward scan pushes every
+    // shift all the way down
+    for (int i = tree.parsed - 1; i >= 0; i--) {
+        if (pending[i] == 0) {
+            continue;
+        }
+        tree.elmore_delay[i] += pending[i];
+        if (tree.type[i] == BRIDGE) {
+            pending[tree.left[i]] += pending[i];
+            pending[tree.right[i]] += pending[i];
+        }
+        pending[i] = 0;
+    }
+
+    DelayWriter fp;
+    if (!fp.open(filename, ctx.io, ctx.index_delays)) {
+        std::cout << "Error: cannot open file\n";
+        return 0;
+    }
+    writeLeafDelays(tree, fp);
+    return fp.close();
+}
+
+int applyEcoFile(EcoSession& eco, const std::string& edits, const std::string& filename) {
+    std::ifstream fin(edits);
+    if (!fin) {
+        cout << "Unable to open file" << endl;
+        return 0;
+    }
+    std::string line;
+    int line_no = 0;
+    int uncommitted = 0;
+    while (std::getline(fin, line)) {
+        line_no++;
+        std::stringstream ss(line);
+        std::string op;
+        if (!(ss >> op) || op[0] == '#') {
+            continue;
+        }
+
+        int node;
+        double a, b;
+        int ok;
+        if (op == "wire" && ss >> node >> a >> b) {
+            ok = eco.setWire(node, a, b);
+            uncommitted++;
+        } else if (op == "cap" && ss >> node >> a) {
+            ok = eco.setSinkCap(node, a);
+            uncommitted++;
+        } else if (op == "commit") {
+            ok = eco.commit(filename);
+            uncommitted = 0;
+        } else if (op == "inverter") {
+            cout << "Line " << line_no << ": inverters cannot be moved, out2 is timed before insertion places any"
+                 << endl;
+            return 0;
+        } else {
+            cout << "Malformed edit on line " << line_no << endl;
+            return 0;
+        }
+        if (!ok) {
+            return 0;
+        }
+    }
+    return uncommitted == 0 || eco.commit(filename);
+}
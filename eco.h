@@ -0,0 +1,59 @@
+#ifndef ECO_H
+#define ECO_H
+
+#include <string>
+#include <vector>
+#include "tree.h"
+
+// Incremental re-timing of a parsed tree after small edits (ECO). The tree
+// must have its delays from elmoreDelay and no inverters yet.
+//
+// An edit fixes the capacitances on the path from the edited node to the
+// root and the delays on that path; every subtree hanging off the path is
+// only marked with how much its delays moved. Each edit therefore costs
+// O(depth). commit() pushes the marks down the affected subtrees and
+// writes out2 again. Edits can be batched freely between commits.
+//
+// Inverters cannot be moved: out2 is timed before insertion, when the tree
+// has none, and where they go is what insertion works out afterwards.
+class EcoSession {
+public:
+    EcoSession(const Context& ctx, Tree& tree);
+
+    // new lengths of both wires below a non-leaf
+    int setWire(int node, double left_wire, double right_wire);
+    // new capacitance of a sink
+    int setSinkCap(int node, double cap);
+
+    // current delay of node, pending shifts included
+    double delay(int node) const;
+
+    // settles all delays and writes out2; returns 0 if the file cannot be written
+    int commit(const std::string& filename);
+
+private:
+    const Context& ctx;
+    Tree& tree;
+    std::vector<int> parent;
+    // delay still to be added to every node of the subtree
+    std::vector<double> pending;
+    std::vector<int> path;    // scratch, node first
+
+    int checkNode(int node, NodeType type) const;
+    void addCapacitance(int node, double cap);
+    void retimePath(int node);
+};
+
+// Applies an edit file to the session, one edit per line:
+//
+//   wire <node> <left wire> <right wire>
+//   cap <node> <sink capacitance>
+//   commit
+//
+// Nodes are numbered by their record in the topology file, from 0. Blank
+// lines and lines starting with '#' are skipped. Every commit line writes
+// out2 to filename, and so does the end of the file if edits are left. An
+// "inverter" line is refused with a note that there are none to move.
+int applyEcoFile(EcoSession& eco, const std::string& edits, const std::string& filename);
+
+#endif
@@ -0,0 +1,145 @@
+// Writes synthetic nets in the .txt post-order format, for scaling runs.
+//
+//   ./pa1_gentree SHAPE SINKS OUT [--long-wires] [--seed N]
+//
+// Shapes:
+//   balanced  every non-leaf splits its sinks in half
+//   htree     balanced with equal sinks, wires halve every second level
+//             (SINKS is rounded up to a power of two)
+//   random    random binary tree, built left to right
+//   chain     every non-leaf has the rest of the chain on its left and one
+//             sink on its right (skewed, depth = SINKS)
+// --long-wires makes every wire 20 times longer, so most of them need
+// repeaters. Output is streamed, so SINKS is only bounded by the disk.
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <cmath>
+#include <random>
+#include <string>
+#include <vector>
+#include "writer.h"
+
+struct Generator {
+    BufferedWriter out;
+    std::mt19937_64 rng;
+    double wire_scale = 1;
+    long label = 0;
+
+    double uniform(double lo, double hi) {
+        return std::uniform_real_distribution<double>(lo, hi)(rng);
+    }
+
+    void sink(double cap) {
+        out.print((int) ++label);
+        out.print('(');
+        out.printSci(cap, 10);
+        out.print(")\n");
+    }
+
+    void bridge(double lw, double rw) {
+        out.print('(');
+        out.printSci(lw * wire_scale, 10);
+        out.print(' ');
+        out.printSci(rw * wire_scale, 10);
+        out.print(")\n");
+    }
+
+    // depth is at most log2(sinks), recursion is fine here
+    void balanced(long sinks) {
+        if (sinks == 1) {
+            sink(uniform(1e-14, 5e-14));
+            return;
+        }
+        balanced((sinks + 1) / 2);
+        balanced(sinks / 2);
+        bridge(uniform(1e4, 1e6), uniform(1e4, 1e6));
+    }
+
+    void htree(int levels, double wire) {
+        if (levels == 0) {
+            sink(2e-14);
+            return;
+        }
+        // the wire below a level shrinks on every other level
+        double below = (levels % 2 == 0) ? wire : wire / 2;
+        htree(levels - 1, below);
+        htree(levels - 1, below);
+        bridge(wire, wire);
+    }
+
+    // a subtree is closed with a coin flip whenever two are open, so the
+    // shape is random but every prefix stays a valid post-order
+    void random(long sinks) {
+        long open = 0;
+        long left = sinks;
+        while (left > 0 || open > 1) {
+            bool leaf = left > 0 && (open < 2 || (rng() & 1));
+            if (leaf) {
+                sink(uniform(1e-14, 5e-14));
+                left--;
+                open++;
+            } else {
+                bridge(uniform(1e3, 5e5), uniform(1e3, 5e5));
+                open--;
+            }
+        }
+    }
+
+    void chain(long sinks) {
+        for (long i = 1; i <= sinks; i++) {
+            sink(uniform(1e-14, 5e-14));
+            if (i > 1) {
+                bridge(uniform(1e3, 1e5), uniform(1e3, 1e5));
+            }
+        }
+    }
+};
+
+int main(int argc, char** argv) {
+    if (argc < 4) {
+        printf("Usage: %s balanced|htree|random|chain SINKS OUT [--long-wires] [--seed N]\n", argv[0]);
+        return 2;
+    }
+    std::string shape = argv[1];
+    long sinks = atol(argv[2]);
+    if (sinks < 1) {
+        printf("SINKS has to be at least 1\n");
+        return 2;
+    }
+
+    Generator gen;
+    unsigned long seed = 1;
+    for (int a = 4; a < argc; a++) {
+        if (strcmp(argv[a], "--long-wires") == 0) {
+            gen.wire_scale = 20;
+        } else if (strcmp(argv[a], "--seed") == 0 && a + 1 < argc) {
+            seed = strtoul(argv[++a], nullptr, 10);
+        } else {
+            printf("Unknown option %s\n", argv[a]);
+            return 2;
+        }
+    }
+    gen.rng.seed(seed);
+
+    if (!gen.out.open(argv[3])) {
+        printf("Unable to open file.\n");
+        return 1;
+    }
+    if (shape == "balanced") {
+        gen.balanced(sinks);
+    } else if (shape == "htree") {
+        int levels = 0;
+        while ((1L << levels) < sinks) levels++;
+        // about 1e3 at the sinks
+        gen.htree(levels, 1e3 * std::pow(2.0, levels / 2));
+    } else if (shape == "random") {
+        gen.random(sinks);
+    } else if (shape == "chain") {
+        gen.chain(sinks);
+    } else {
+        printf("Unknown shape %s\n", shape.c_str());
+        return 2;
+    }
+    return gen.out.close() ? 0 : 1;
+}
@@ -0,0 +1,176 @@
+#include "instrument.h"
+
+#ifdef PA1_INSTRUMENT
+
+#include <algorithm>
+#include <atomic>
+#include <map>
+#include <mutex>
+#include <vector>
+#include "writer.h"
+
+namespace instrument {
+
+static const char* counter_names[COUNTERS] = {
+    "nodes_parsed", "quadratic_solves", "segment_inverters", "polarity_inverters", "bytes_written",
+};
+
+struct Event {
+    const char* name;
+    int thread;
+    long start_ns;
+    long duration_ns;
+};
+
+// Only the owning thread writes its counters, with plain load/store pairs;
+// the atomics are there so a report can read them while it runs.
+struct ThreadCounters {
+    std::atomic<long> values[COUNTERS] = {};
+    ThreadCounters();
+    ~ThreadCounters();
+};
+
+static const std::chrono::steady_clock::time_point origin = std::chrono::steady_clock::now();
+static std::mutex lock;
+static std::vector<ThreadCounters*> live;
+static long retired[COUNTERS];   // counts of threads that are gone
+static std::vector<Event> events;
+static std::atomic<int> next_thread{0};
+
+static int threadId() {
+    static thread_local int id = next_thread++;
+    return id;
+}
+
+ThreadCounters::ThreadCounters() {
+    std::lock_guard<std::mutex> guard(lock);
+    live.push_back(this);
+}
+
+ThreadCounters::~ThreadCounters() {
+    std::lock_guard<std::mutex> guard(lock);
+    for (int c = 0; c < COUNTERS; c++) {
+        retired[c] += values[c].load(std::memory_order_relaxed);
+    }
+    live.erase(std::find(live.begin(), live.end(), this));
+}
+
+ThreadCounters& threadCounters() {
+    static thread_local ThreadCounters mine;
+    return mine;
+}
+
+void add(ThreadCounters& c, Counter counter, long n) {
+    std::atomic<long>& v = c.values[counter];
+    v.store(v.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+}
+
+PhaseTimer::~PhaseTimer() {
+    auto end = std::chrono::steady_clock::now();
+    Event e;
+    e.name = name;
+    e.thread = threadId();
+    e.start_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(start - origin).count();
+    e.duration_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(end - start).count();
+    std::lock_guard<std::mutex> guard(lock);
+    events.push_back(e);
+}
+
+// sums over every thread; the caller holds lock
+static void totals(long* sums) {
+    for (int c = 0; c < COUNTERS; c++) {
+        sums[c] = retired[c];
+        for (ThreadCounters* t : live) {
+            sums[c] += t->values[c].load(std::memory_order_relaxed);
+        }
+    }
+}
+
+int writeReport(const std::string& filename) {
+    BufferedWriter out;
+    if (!out.open(filename)) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> guard(lock);
+
+    // phases in the order they first ran
+    std::vector<const char*> order;
+    std::map<std::string, std::pair<long, long>> phases;   // calls, ns
+    for (const Event& e : events) {
+        auto& p = phases[e.name];
+        if (p.first == 0) {
+            order.push_back(e.name);
+        }
+        p.first++;
+        p.second += e.duration_ns;
+    }
+
+    out.print("{\n  \"phases\": {");
+    for (size_t i = 0; i < order.size(); i++) {
+        auto& p = phases[order[i]];
+        out.print(i ? ",\n" : "\n");
+        out.print("    \"");
+        out.print(order[i]);
+        out.print("\": {\"calls\": ");
+        out.print((int) p.first);
+        out.print(", \"seconds\": ");
+        out.printSci(p.second / 1e9);
+        out.print('}');
+    }
+    out.print("\n  },\n  \"counters\": {");
+    long sums[COUNTERS];
+    totals(sums);
+    for (int c = 0; c < COUNTERS; c++) {
+        out.print(c ? ",\n" : "\n");
+        out.print("    \"");
+        out.print(counter_names[c]);
+        out.print("\": ");
+        out.print(std::to_string(sums[c]).c_str());
+    }
+    out.print("\n  }\n}\n");
+    return out.close();
+}
+
+int writeTrace(const std::string& filename) {
+    BufferedWriter out;
+    if (!out.open(filename)) {
+        return 0;
+    }
+    std::lock_guard<std::mutex> guard(lock);
+
+    // times are in microseconds
+    out.print("{\"traceEvents\": [");
+    for (size_t i = 0; i < events.size(); i++) {
+        const Event& e = events[i];
+        out.print(i ? ",\n" : "\n");
+        out.print("{\"name\": \"");
+        out.print(e.name);
+        out.print("\", \"ph\": \"X\", \"pid\": 1, \"tid\": ");
+        out.print(e.thread);
+        out.print(", \"ts\": ");
+        out.print(std::to_string(e.start_ns / 1000.0).c_str());
+        out.print(", \"dur\": ");
+        out.print(std::to_string(e.duration_ns / 1000.0).c_str());
+        out.print('}');
+    }
+    // the counters as one sample at the end of the run
+    long sums[COUNTERS];
+    totals(sums);
+    long end_ns = std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - origin).count();
+    out.print(events.empty() ? "\n" : ",\n");
+    out.print("{\"name\": \"counters\", \"ph\": \"C\", \"pid\": 1, \"ts\": ");
+    out.print(std::to_string(end_ns / 1000.0).c_str());
+    out.print(", \"args\": {");
+    for (int c = 0; c < COUNTERS; c++) {
+        out.print(c ? ", \"" : "\"");
+        out.print(counter_names[c]);
+        out.print("\": ");
+        out.print(std::to_string(sums[c]).c_str());
+    }
+    out.print("}}\n]}\n");
+    return out.close();
+}
+
+}
+
+#endif
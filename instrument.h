@@ -0,0 +1,73 @@
+#ifndef INSTRUMENT_H
+#define INSTRUMENT_H
+
+// Phase timers and counters for finding where a run spends its time. Built
+// in only with -DPA1_INSTRUMENT (make INSTRUMENT=1); otherwise both macros
+// expand to nothing and none of this is compiled.
+//
+//   PA1_PHASE("elmore");                   times the rest of the scope
+//   PA1_COUNT(COUNT_QUADRATIC_SOLVES, 1);  adds to a counter
+//
+// Counters are kept per thread and summed when a report is written, so
+// counting in the parallel passes does not bounce a cache line around.
+
+enum Counter {
+    COUNT_NODES_PARSED,
+    COUNT_QUADRATIC_SOLVES,
+    COUNT_SEGMENT_INVERTERS,    // inverters inserted by inverterSegmentation
+    COUNT_POLARITY_INVERTERS,   // inverters inserted to fix polarity
+    COUNT_BYTES_WRITTEN,
+    COUNTERS
+};
+
+#ifdef PA1_INSTRUMENT
+
+#include <chrono>
+#include <string>
+
+namespace instrument {
+
+struct ThreadCounters;
+ThreadCounters& threadCounters();
+void add(ThreadCounters& c, Counter counter, long n);
+
+inline void count(Counter counter, long n) {
+    static thread_local ThreadCounters& mine = threadCounters();
+    add(mine, counter, n);
+}
+
+// records name with its start and duration when it goes out of scope
+class PhaseTimer {
+public:
+    explicit PhaseTimer(const char* phase) : name(phase), start(std::chrono::steady_clock::now()) {}
+    ~PhaseTimer();
+
+    PhaseTimer(const PhaseTimer&) = delete;
+    PhaseTimer& operator=(const PhaseTimer&) = delete;
+
+private:
+    const char* name;
+    std::chrono::steady_clock::time_point start;
+};
+
+// Totals per phase and the counters as JSON; returns 0 if the file cannot be
+// written
+int writeReport(const std::string& filename);
+// every timed phase as a complete event, for chrome://tracing or Perfetto
+int writeTrace(const std::string& filename);
+
+}
+
+#define PA1_CONCAT2(a, b) a##b
+#define PA1_CONCAT(a, b) PA1_CONCAT2(a, b)
+#define PA1_PHASE(name) instrument::PhaseTimer PA1_CONCAT(pa1_phase_, __LINE__)(name)
+#define PA1_COUNT(counter, n) instrument::count(counter, n)
+
+#else
+
+#define PA1_PHASE(name) ((void) 0)
+#define PA1_COUNT(counter, n) ((void) 0)
+
+#endif
+
+#endif
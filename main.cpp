@@ -1,660 +1,443 @@
 #include <iostream>
-#include <fstream>
-#include <sstream>
-#include <stack>
 #include <string>
+#include <cstring>
+#include <chrono>
 #include <memory>
-#include <cctype>
-#include <cmath>
+#include <thread>
+#include <vector>
+#include <sstream>
+#include <algorithm>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include "tree.h"
+#include "batch.h"
+#include "eco.h"
+#include "snapshot.h"
+#include "instrument.h"
+#include "trace.h"
 using namespace std;
 
-double unit_wire_res = 0;
-double unit_wire_cap = 0;
-
-double inv_input_cap = 0;
-double inv_output_cap = 0;
-double inv_output_res = 0;
-
-double time_constraint = 0;
-
-enum NodeType {
-    LEAF,
-    BRIDGE,
-    INV
-};
-
-
-struct Node {
-    NodeType type;
-    int label;                    // valid if isLeaf
-    double capacitance;           // valid if isLeaf
-
-    double leftWire, rightWire;   // valid if !isLeaf
-    Node* left;
-    Node* right;
-
-    double total_capacitance;
-    double elmore_capacitance;
-    double elmore_delay;
-
-    double cut_wire;
-
-    int polarity;
-
-    Node(int lbl, double cap) 
-        : type(LEAF), label(lbl), capacitance(cap),
-          leftWire(0), rightWire(0), left(nullptr), right(nullptr), 
-          total_capacitance(0.0), elmore_capacitance(0.0), elmore_delay(0.0), cut_wire(0), polarity(0){}
-
-    Node(double lw, double rw, Node* l, Node* r)
-        : type(BRIDGE), label(-1), capacitance(0),
-          leftWire(lw), rightWire(rw), left(l), right(r),
-          total_capacitance(0.0), elmore_capacitance(0.0), elmore_delay(0.0), cut_wire(0), polarity(0){}
-
-    Node(double cap, double wire_left, bool inv)
-        :type(INV), label(-1), capacitance(cap),
-        leftWire(0), rightWire(0), left(nullptr), right(nullptr), 
-        total_capacitance(0.0), elmore_capacitance(0.0), elmore_delay(0.0), cut_wire(wire_left), polarity(0) {
-
+// "a,b,c" or "first:last:count", count constraints evenly spaced from first
+// to last; names are what per-constraint output files get as a suffix
+static bool parseConstraintList(const std::string& list, std::vector<double>& values, std::vector<std::string>& names) {
+    char* end;
+    if (std::count(list.begin(), list.end(), ':') == 2) {
+        size_t c1 = list.find(':');
+        size_t c2 = list.find(':', c1 + 1);
+        double first = strtod(list.c_str(), &end);
+        double last = strtod(list.c_str() + c1 + 1, &end);
+        int count = atoi(list.c_str() + c2 + 1);
+        if (count < 1) {
+            return false;
         }
-};
-
-
-int storeWireParams(const std::string& filename) {
-    std::ifstream fin(filename); // object for a file
-    if (!fin) { // NULL if unable to open file
-        cout << "Unable to open file" << endl;
-        return 0;
-    }
-
-    std::string line;
-
-    std::getline(fin, line);
-    if (line.empty())  {
-        return 0;
-    }
-
-    double unit_res;
-    double unit_cap;
-    std::stringstream ss(line);
-    ss >> unit_res >> unit_cap; // reads: label '(' capacitance
-
-    unit_wire_res = unit_res;
-    unit_wire_cap = unit_cap;
-
-    fin.close();
-    return 1;
-
-} 
-
-int storeInvParams(const std::string& filename) {
-    std::ifstream fin(filename); // object for a file
-    if (!fin) { // NULL if unable to open file
-        cout << "Unable to open file" << endl;
-        return 0;
-    }
-
-    std::string line;
-
-    std::getline(fin, line);
-    if (line.empty())  {
-        return 0;
-    }
-
-    double first;
-    double second;
-    double third;
-    std::stringstream ss(line);
-    ss >> first >> second >> third; // reads: label '(' capacitance
-
-    inv_input_cap = first;
-    inv_output_cap = second;
-    inv_output_res = third;
-
-    fin.close();
-    return 1;
-}
-Node* parseTree(const std::string& filename) {
-    std::ifstream fin(filename); // object for a file
-    if (!fin) { // NULL if unable to open file
-        cout << "Unable to open file" << endl;
-        return NULL;
+        for (int k = 0; k < count; k++) {
+            double value = count == 1 ? first : first + (last - first) * k / (count - 1);
+            std::ostringstream name;
+            name << value;
+            values.push_back(value);
+            names.push_back(name.str());
+        }
+        return true;
     }
 
-    std::stack<Node*> st; // to declare stack just define stack object
-    std::string line;
-
-    while (std::getline(fin, line)) {
-        if (line.empty()) continue;
-
-        // Leaf node format: d(%.10le)
-        if (std::isdigit(line[0])) {
-            int lbl;
-            double cap;
-            char dummy;
-            std::stringstream ss(line);
-            ss >> lbl >> dummy >> cap; // reads: label '(' capacitance
-            Node* leaf = new Node(lbl, cap);
-            
-            leaf->total_capacitance += cap;
-            
-            st.push(leaf);
+    size_t pos = 0;
+    while (pos <= list.size()) {
+        size_t comma = list.find(',', pos);
+        if (comma == std::string::npos) {
+            comma = list.size();
         }
-        // non-leaf node format: (%.10le %.10le)
-        else if (line[0] == '(') {
-            double lw, rw;
-            char dummy;
-            std::stringstream ss(line);
-            ss >> dummy >> lw >> rw; // reads: '(' leftWire rightWire
-            Node* right = st.top(); st.pop();
-            Node* left = st.top(); st.pop();
-            Node* parent = new Node(lw, rw, left, right);
-
-            // at this point we know wire connecting parent to child
-            double l_wire_cap = unit_wire_cap * lw / (double) 2;
-            double r_wire_cap = unit_wire_cap * rw / (double) 2;
-
-            left->total_capacitance += l_wire_cap; // calculate Ce/2 of left wire
-            right->total_capacitance += r_wire_cap; // calculate Ce/2 of right wire
-
-            parent-> total_capacitance += l_wire_cap + r_wire_cap;//Ce/2 of left wire and right
-            
-            st.push(parent);
+        std::string item = list.substr(pos, comma - pos);
+        double value = strtod(item.c_str(), &end);
+        if (item.empty() || *end != '\0') {
+            return false;
         }
+        values.push_back(value);
+        names.push_back(item);
+        pos = comma + 1;
     }
+    return true;
+}
 
-    if (st.empty()) {
-        cout << "No tree found in file." << endl;
-        return NULL;
-    }
-
-    Node* root = st.top();
-    root->total_capacitance += inv_output_cap;
-    // root is missing capacitance going into it Ce
-    return root;
-
-    fin.close();
+static void printPeakMemory() {
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    cout << "peak RSS: " << usage.ru_maxrss / 1024.0 << " MB" << endl;
 }
 
-void preOrderTraversal(Node * node, std::ofstream& fout) {
-    if (!node) {
-        return;
+// --profile, --trace and --trace-log, covering the run up to here
+static void writeDiagnostics(const std::string& profile, const std::string& chrome_trace, const std::string& trace_log) {
+#ifdef PA1_INSTRUMENT
+    if (!profile.empty() && !instrument::writeReport(profile)) {
+        cout << "Unable to write " << profile << endl;
     }
-
-    if (node->type==LEAF) {
-        fout << node->label << "(" << std::scientific << node->capacitance << ")\n";
-        //cout << "Leaf Node total capacitance: " << node->total_capacitance << endl;
-        //cout << "Leaf Node elmore capacitance: " << node->elmore_capacitance << endl;
-        //cout << "Leaf Node elmore delay: " << node->elmore_delay << endl;
-
-
-
-    } else if (node->type==BRIDGE){
-        //cout << "Non-Leaf Node total capacitance: " << node->total_capacitance << endl;
-        //cout << "Non-Leaf Node elmore capacitance: " << node->elmore_capacitance << endl;
-        //cout << "Non-Leaf Node elmore delay: " << node->elmore_delay << endl;
-
-        fout << "(" << std::scientific << node->leftWire << " " << node->rightWire << ")\n";
+    if (!chrome_trace.empty() && !instrument::writeTrace(chrome_trace)) {
+        cout << "Unable to write " << chrome_trace << endl;
     }
-
-    preOrderTraversal(node->left, fout);
-    preOrderTraversal(node->right, fout);
-
-}
-
-int writePre(Node * root, const std::string& filename) {
-    std::ofstream fout(filename);
-    if (!fout) {
-        cout << "Unable to open file.\n";
-        return 0;
+#else
+    (void) profile;
+    (void) chrome_trace;
+#endif
+#if PA1_TRACE_LEVEL > 0
+    if (!trace_log.empty() && !trace::dump(trace_log)) {
+        cout << "Unable to write " << trace_log << endl;
     }
-
-    preOrderTraversal(root, fout);
-
-    fout.close();   // closes the std::ofstream
-    return 1;
+#else
+    (void) trace_log;
+#endif
 }
 
-double capacitancePostOrder(Node * node) {
-    if (!node) {
-        return 0;
+int main(int argc, char **argv) {
+    bool huge_pages = false;
+    bool stats = false;
+    bool streaming = false;
+    Context ctx;
+    std::string manifest;
+    std::string eco_edits;
+    std::string profile, chrome_trace;
+    std::string trace_log, trace_categories;
+    // snapshots to take after the Elmore pass and after insertion
+    std::string save_snapshot, save_snapshot_inserted;
+    int threads = 1;
+    bool sweep = false;
+    bool sweep_outputs = false;
+    // extra corners, each as inv.param and wire.param
+    std::vector<std::string> corner_inv, corner_wire;
+
+    // options come before the positional arguments
+    int argi = 1;
+    for (; argi < argc && strncmp(argv[argi], "--", 2) == 0; argi++) {
+        std::string opt = argv[argi];
+        if (opt == "--hugepages") {
+            huge_pages = true;
+        } else if (opt == "--stream") {
+            streaming = true;
+        } else if (opt == "--threads" && argi + 1 < argc) {
+            threads = atoi(argv[++argi]);
+        } else if (opt == "--sweep") {
+            sweep = true;
+        } else if (opt == "--sweep-outputs") {
+            sweep = true;
+            sweep_outputs = true;
+        } else if (opt == "--corner" && argi + 1 < argc) {
+            std::string files = argv[++argi];
+            size_t comma = files.find(',');
+            if (comma == std::string::npos) {
+                std::cout << "--corner takes inv.param,wire.param\n";
+                return 2;
+            }
+            corner_inv.push_back(files.substr(0, comma));
+            corner_wire.push_back(files.substr(comma + 1));
+        } else if (opt == "--io=write") {
+            ctx.io = IO_WRITE;
+        } else if (opt == "--io=writev") {
+            ctx.io = IO_WRITEV;
+        } else if (opt == "--io=direct") {
+            ctx.io = IO_DIRECT;
+        } else if (opt == "--batch" && argi + 1 < argc) {
+            manifest = argv[++argi];
+        } else if (opt == "--engine=greedy") {
+            ctx.engine = ENGINE_GREEDY;
+        } else if (opt == "--engine=dp") {
+            ctx.engine = ENGINE_DP;
+        } else if (opt == "--dp-points" && argi + 1 < argc) {
+            ctx.dp_points_per_stage = atoi(argv[++argi]);
+            if (ctx.dp_points_per_stage < 1) {
+                std::cout << "--dp-points takes a count of at least 1\n";
+                return 2;
+            }
+        } else if (opt == "--out2=plain") {
+            ctx.index_delays = false;
+        } else if (opt == "--out2=indexed") {
+            ctx.index_delays = true;
+        } else if (opt == "--pipeline") {
+            ctx.pipeline = true;
+        } else if (opt == "--share-subtrees") {
+            ctx.share_subtrees = true;
+        } else if (opt == "--eco" && argi + 1 < argc) {
+            eco_edits = argv[++argi];
+        } else if (opt == "--save-snapshot" && argi + 1 < argc) {
+            save_snapshot = argv[++argi];
+        } else if (opt == "--save-snapshot-inserted" && argi + 1 < argc) {
+            save_snapshot_inserted = argv[++argi];
+        } else if (opt == "--stats") {
+            stats = true;
+        } else if (opt == "--profile" && argi + 1 < argc) {
+            profile = argv[++argi];
+        } else if (opt == "--trace" && argi + 1 < argc) {
+            chrome_trace = argv[++argi];
+        } else if (opt == "--trace-log" && argi + 1 < argc) {
+            trace_log = argv[++argi];
+        } else if (opt == "--trace-categories" && argi + 1 < argc) {
+            trace_categories = argv[++argi];
+        } else {
+            std::cout << "Unknown option " << opt << "\n";
+            return 2;
+        }
     }
-
-    double left_cap = capacitancePostOrder(node->left);
-    double right_cap = capacitancePostOrder(node->right);
-    
-    node->elmore_capacitance = left_cap + right_cap + (node->total_capacitance);
-    
-    return node->elmore_capacitance;
-
-}
-void delayPreOrder(Node * node, double curr_elmore_delay, double resistance, FILE *fp) {
-    if (!node) {
-        return;
+#ifndef PA1_INSTRUMENT
+    if (!profile.empty() || !chrome_trace.empty()) {
+        std::cout << "--profile and --trace need a build with INSTRUMENT=1\n";
+        return 2;
     }
-
-    curr_elmore_delay += (resistance * node->elmore_capacitance);
-    node->elmore_delay = curr_elmore_delay;
-
-    if (node->type==LEAF) {
-        fwrite(&(node->label), sizeof(int), 1, fp);
-        fwrite(&(node->elmore_delay), sizeof(double), 1, fp);
+#endif
+#if PA1_TRACE_LEVEL > 0
+    if (!trace_categories.empty()) {
+        unsigned mask;
+        if (!trace::parseCategories(trace_categories, mask)) {
+            std::cout << "Unknown category in " << trace_categories << "\n";
+            return 2;
+        }
+        trace::enabled = mask;
     }
-    delayPreOrder(node->left, curr_elmore_delay, unit_wire_res * node->leftWire, fp);
-    delayPreOrder(node->right, curr_elmore_delay, unit_wire_res * node->rightWire, fp);
-
-}
-int elmoreDelay(Node * root, std::string& filename) {
-    // bottom up (post-order) traversal to accumulate capacitance
-    // top down (pre-order) for R*C = T
-
-    capacitancePostOrder(root);
-
-    FILE* fp = fopen(filename.c_str(), "wb");  // convert std::string to const char*
-    if (!fp) {
-        std::cout << "Error: cannot open file\n";
-        return 0;
+#else
+    if (!trace_log.empty() || !trace_categories.empty()) {
+        std::cout << "--trace-log and --trace-categories need a build with TRACE_LEVEL=1 or 2\n";
+        return 2;
     }
-    delayPreOrder(root, 0, inv_output_res, fp);
-
-    fclose(fp);     // closes the FILE* handle
-    return 1;
-}  
-
-double solveQuadratic(double A, double B, double C) {
-
-    //cout << "A, B, C : " << A << "," << B << "," << C << "," << endl;
-    double discriminant = (B*B) - (4*A*C);
-    double new_l = -1;
-    //cout << "square root of discriminant: " << (std::sqrt(discriminant)) << endl;
-
-    if (discriminant < 0) {
-        // complex roots, no solution
-        return -1;
-    } else if (discriminant == 0) {
-        new_l = (0-B) / (2*A);
-    }  else {
+#endif
 
-        double first_root = (-B + (std::sqrt(discriminant))) / (2 * A);
-        double second_root = (-B - (std::sqrt(discriminant))) / (2 * A);
-        //cout << "first root: " << first_root << endl;
-        //cout << "second root: " << second_root << endl;
-
-        if (first_root > second_root) {
-            if (first_root < 0) {
-                return -1;
-            } else {
-                return first_root;
-            }
+    if (!manifest.empty()) {
+        // every net comes from the manifest, there are no positional arguments
+        if (argc != argi) {
+            std::cout << "Invalid number of arguments";
+            return 2;
         }
-        else {
-            if (second_root < 0) {
-                return -1;
-            } else {
-                return second_root;
-            }
+        int failed = runBatch(manifest, threads, ctx);
+        writeDiagnostics(profile, chrome_trace, trace_log);
+        if (stats) {
+            printPeakMemory();
         }
- 
+        return failed == 0 ? 0 : 1;
     }
-    return new_l;
-}
-
-Node * inverterSegmentation(Node * node, double l, double branch_time_constraint) {
 
-    if (node->type==LEAF) {
-        //cout << "Leaf " << node->label << "(" << node->capacitance << ")\n";
+    if (argc - argi != 8) {
+        std::cout << "Invalid number of arguments";
+        return 2;
+    }
+    argv += argi - 1;
+
+    std::vector<double> constraints;
+    std::vector<std::string> constraint_names;
+    if (sweep) {
+        // the first argument is a list of constraints instead
+        if (!parseConstraintList(argv[1], constraints, constraint_names)) {
+            std::cout << "Invalid constraint list " << argv[1] << "\n";
+            return 2;
+        }
     } else {
-        //cout <<  "Non-leaf (" << node->leftWire << "," << node->rightWire << ")\n";
-
+        ctx.time_constraint = atof(argv[1]);    
     }
-    Node * temp = node;
-    double temp_l = l;
-
-    double temp_time_constraint = time_constraint - branch_time_constraint;
-
-    double temp_elmore_c = temp->elmore_capacitance - ((temp_l * unit_wire_cap) / (double) 2);
-
-
-        // Quadratic coefficients
-    double A = (unit_wire_cap * unit_wire_res) / 2;
-    double B = (inv_output_res * unit_wire_cap) + (unit_wire_res * temp_elmore_c);
-    //cout << "Elmore's capacitance: " << temp_elmore_c << endl;
-    double C = (inv_output_res * inv_output_cap) + (inv_output_res * temp_elmore_c);
-
-    double stage_delay = (A*(l*l)) + (B*l) + C;
-    //cout << "stage delay: " <<stage_delay <<endl;
-    //cout << "Time constraint: " <<temp_time_constraint <<endl;
-
-    while (stage_delay > temp_time_constraint) {
-        temp_elmore_c = temp->elmore_capacitance - ((temp_l * unit_wire_cap) / (double) 2);
-        // Quadratic coefficients
-        A = (unit_wire_cap * unit_wire_res) / 2;
-        B = (inv_output_res * unit_wire_cap) + (unit_wire_res * temp_elmore_c);
-        C = (inv_output_res * inv_output_cap) + (inv_output_res * temp_elmore_c) - temp_time_constraint;
-
-        double new_l = solveQuadratic(A, B, C);
-
-        //cout << "L computed: " << new_l << endl;
-        if (new_l == -1) {
-            // try inserting on left and right
-            return temp;
-        } else {
-            Node * inv = new Node(inv_input_cap, temp_l - new_l, true);
-            inv->leftWire = new_l;
-            inv->rightWire = -1;
-            inv->left = temp;
-            inv->total_capacitance=inv->capacitance + ((inv->cut_wire * unit_wire_cap) / 2);
-            inv->elmore_capacitance = inv->total_capacitance;
-            /* at this point, inv node is set up with:
-                - Input capacitance
-                - left pointer towards child
-                - total and elmore capacitcance updated to 
-
-            */
-
-            
-            temp = inv;
-            temp_l -= new_l;
-            temp->polarity=(1 + temp->left->polarity)%2;
-
-            temp_elmore_c = temp->elmore_capacitance - ((temp_l * unit_wire_cap) / (double) 2);
-            // Quadratic coefficients
-            A = (unit_wire_cap * unit_wire_res) / 2;
-            B = (inv_output_res * unit_wire_cap) + (unit_wire_res * temp_elmore_c);
-            C = (inv_output_res * inv_output_cap) + (inv_output_res * temp_elmore_c);
-
+    std::string in_name1 = argv[2];
+    std::string in_name2 = argv[3];
+    std::string in_name3 = argv[4];
+    std::string out_name1 = argv[5];
+    std::string out_name2 = argv[6];
+    std::string out_name3 = argv[7];
+    std::string out_name4 = argv[8];
 
-            stage_delay = (A*(temp_l*temp_l)) + (B*temp_l) + C;
-            
-            temp_time_constraint = time_constraint;
-            //cout << "stage delay: " <<stage_delay <<endl;
-            //cout << "Time constraint: " <<temp_time_constraint <<endl;
+    storeWireParams(in_name2, ctx);
+    storeInvParams(in_name1, ctx);
+
+    // the corners from the command line come first
+    std::vector<Context> corners;
+    if (!corner_inv.empty()) {
+        corner_inv.insert(corner_inv.begin(), in_name1);
+        corner_wire.insert(corner_wire.begin(), in_name2);
+        corners.assign(corner_inv.size(), ctx);
+        if (!storeInvParams(corner_inv, corners) || !storeWireParams(corner_wire, corners)) {
+            return 1;
         }
-
-
     }
 
-    return temp;
-}
-Node* insertionPostOrder(Node * node, double l) {
-    if (!node) {
-        return NULL;
+    if (!eco_edits.empty() && (!corners.empty() || streaming)) {
+        std::cout << "--eco does not work with --corner or --stream\n";
+        return 2;
     }
-
-    // temp will either carry original child or inverter
-    Node * temp_left = insertionPostOrder(node->left, node->leftWire);
-    if (temp_left) {
-        if (temp_left->type==INV) {
-            //Left branch had an inverter inserted
-            double old_child_cap = node->left->elmore_capacitance;
-            node->left = temp_left;
-            
-            node->total_capacitance-=(node->leftWire * unit_wire_cap) / 2;
-            node->elmore_capacitance-=(node->leftWire * unit_wire_cap) / 2;; 
-            node->elmore_capacitance-=old_child_cap; 
-
-            node->leftWire = node->left->cut_wire;
-            node->total_capacitance+=(node->leftWire * unit_wire_cap) / 2; //good
-            node->elmore_capacitance+=node->left->elmore_capacitance;
-            node->elmore_capacitance+=(node->leftWire * unit_wire_cap) / 2;
-            
-            //cout << "Polarity of returned temp_left: " << temp_left->polarity << endl;
-        }
+    if (ctx.share_subtrees && (!corners.empty() || streaming || !eco_edits.empty() || ctx.engine != ENGINE_GREEDY)) {
+        std::cout << "--share-subtrees only works with the greedy engine and no --corner, --stream or --eco\n";
+        return 2;
     }
-    Node * temp_right = insertionPostOrder(node->right, node->rightWire);
-    if (temp_right) {
-        if (temp_right->type==INV) {
-            // right branch had an inverter inserted
-            double old_child_cap = node->right->elmore_capacitance;
-            node->right = temp_right;
-
-            node->total_capacitance-=(node->rightWire * unit_wire_cap) / 2;
-            node->elmore_capacitance-=(node->rightWire * unit_wire_cap) / 2;
-            node->elmore_capacitance-=old_child_cap;
-
-            node->rightWire = node->right->cut_wire;
 
-            node->total_capacitance+=(node->rightWire * unit_wire_cap) / 2;
-            node->elmore_capacitance+=(node->rightWire * unit_wire_cap) / 2;
-            node->elmore_capacitance+=node->right->elmore_capacitance;
-
-            cout << "Polarity of returned temp_right: " << temp_right->polarity << endl;
+    bool saving = !save_snapshot.empty() || !save_snapshot_inserted.empty();
+    if (saving && (!corners.empty() || streaming || ctx.share_subtrees)) {
+        std::cout << "--save-snapshot does not work with --corner, --stream or --share-subtrees\n";
+        return 2;
+    }
+    if (!save_snapshot_inserted.empty() && sweep) {
+        std::cout << "--save-snapshot-inserted does not work with a sweep\n";
+        return 2;
+    }
 
+    // a snapshot given as the topology replaces the parse and the Elmore pass
+    Snapshot snapshot;
+    bool from_snapshot = isSnapshot(in_name3);
+    if (from_snapshot) {
+        if (!corners.empty() || streaming) {
+            std::cout << "A snapshot does not work with --corner or --stream\n";
+            return 2;
+        }
+        if (!snapshot.open(in_name3) || !snapshot.matches(ctx)) {
+            return 1;
+        }
+        if (snapshot.inserted() && (sweep || !eco_edits.empty() || !save_snapshot.empty())) {
+            std::cout << "A snapshot taken after insertion does not work with a sweep, --eco or --save-snapshot\n";
+            return 2;
         }
     }
 
-    // check polarity
-    if (temp_left && temp_right) {
-        if (temp_left->polarity == 0 && temp_right->polarity == 1) {
-            // insert inverter on right branch at length l
-            Node * inv = new Node(inv_input_cap, 0, true);
-            inv->leftWire = node->leftWire;
-            inv->rightWire = -1;
-            inv->left = node->left;
-            inv->total_capacitance=inv->capacitance + ((inv->cut_wire * unit_wire_cap) / 2);
-            inv->elmore_capacitance = inv->total_capacitance;
-
-            inv->polarity = (1 + inv->left->polarity)%2;
-
-            double old_child_cap = node->left->elmore_capacitance;
-            node->left = inv;
-            
-            node->total_capacitance-=(node->leftWire * unit_wire_cap) / 2;
-            node->elmore_capacitance-=(node->leftWire * unit_wire_cap) / 2;; 
-            node->elmore_capacitance-=old_child_cap; 
-
-            node->leftWire = node->left->cut_wire;
-            node->total_capacitance+=(node->leftWire * unit_wire_cap) / 2; //good
-            node->elmore_capacitance+=node->left->elmore_capacitance;
-            node->elmore_capacitance+=(node->leftWire * unit_wire_cap) / 2;
-
-            node->polarity=inv->polarity;
-
-            //cout << "Added extra on left.\n";
-        } 
-        else if (temp_left->polarity == 1 && temp_right->polarity == 0){
-            // insert inverter on left branch at length l
-            Node * inv = new Node(inv_input_cap, 0, true);
-            inv->leftWire = node->rightWire;
-            inv->rightWire = -1;
-
-            inv->left = node->right;
-            inv->total_capacitance=inv->capacitance + ((inv->cut_wire * unit_wire_cap) / 2);
-
-            inv->elmore_capacitance = inv->total_capacitance;
-
-            inv->polarity = (1 + inv->left->polarity)%2;
-            
-            double old_child_cap = node->right->elmore_capacitance;
-            node->right = inv;
-
-            node->total_capacitance-=(node->rightWire * unit_wire_cap) / 2;
-            node->elmore_capacitance-=(node->rightWire * unit_wire_cap) / 2;
-            node->elmore_capacitance-=old_child_cap;
-
-            node->rightWire = node->right->cut_wire;
-            cout << "cut wire: " << node->right->cut_wire << endl;
-            node->total_capacitance+=(node->rightWire * unit_wire_cap) / 2;
-            node->elmore_capacitance+=(node->rightWire * unit_wire_cap) / 2;
-            node->elmore_capacitance+=node->right->elmore_capacitance;
-
-            node->polarity = inv->polarity;
-            cout << "Added extra on right.\n";
-
+    if (streaming) {
+        if (isBinaryTopology(in_name3) || isCompactTopology(in_name3)) {
+            std::cout << "--stream only reads text topologies\n";
+            return 2;
         }
-        else {
-            node->polarity = temp_left->polarity;
+        if (ctx.index_delays) {
+            std::cout << "--stream only writes the plain out2\n";
+            return 2;
         }
-
+        if (!corners.empty()) {
+            std::cout << "--corner does not work with --stream\n";
+            return 2;
+        }
+        // bounded memory, only out2 is written
+        int ok = elmoreDelayStreaming(ctx, in_name3, out_name2);
+        writeDiagnostics(profile, chrome_trace, trace_log);
+        if (stats) {
+            printPeakMemory();
+        }
+        return ok ? 0 : 1;
     }
-    
-
-    if (!temp_left && !temp_right) {
-        // at leaf node
-        // check for insertion
-        // if not needed return node
-        // if insertion return inv node
-
-        //double stage_delay = l * unit_wire_res * (node->elmore_capacitance);
-        
-        return inverterSegmentation(node, l, 0);
 
-    } else {
-        // at bridge node
-        // check for insertion (second method)
-        // return current node or inv node
-        double t1 = (node->leftWire)*unit_wire_res*(node->left->elmore_capacitance);
-        double t2 = (node->rightWire)*unit_wire_res*(node->right->elmore_capacitance);
-        double child_time_constraint = (t1 > t2 ? t1 : t2);
-        //double stage_delay = l * unit_wire_res * (node->elmore_capacitance);
-       
-        return inverterSegmentation(node, l, child_time_constraint);
+    // only worth the threads when asked for
+    std::unique_ptr<TaskPool> pool;
+    if (threads > 1) {
+        pool = std::make_unique<TaskPool>(threads);
     }
 
-
-}
-
-Node * inverterInsertion(Node * root) {
-
-    Node * temp_root = insertionPostOrder(root, 0);
-    return temp_root;
-
-}
-
-void postOrderTraversalOutput3(Node * node, std::ofstream& fout, FILE * fp) {
-    if (!node) {
-        return;
+    Arena arena(huge_pages);
+    Tree tree(&arena);
+    // with --pipeline out2 is still being written while insertion runs
+    DelayWriter out2;
+    auto parse_start = std::chrono::steady_clock::now();
+    if (from_snapshot) {
+        snapshot.restore(tree);
+    } else if (!parseTree(ctx, in_name3, tree, pool.get())) {
+        return 1;
+    }
+    if (stats) {
+        std::chrono::duration<double> secs = std::chrono::steady_clock::now() - parse_start;
+        struct stat st;
+        double mb = stat(in_name3.c_str(), &st) == 0 ? st.st_size / 1e6 : 0;
+        cout << (from_snapshot ? "restore: " : "parse: ") << tree.parsed << " nodes, " << mb << " MB in " << secs.count()
+             << " s (" << mb / secs.count() << " MB/s)" << endl;
+        if (tree.shared()) {
+            cout << "shared: " << tree.sink_labels.size() << " sinks" << endl;
+        }
     }
-    postOrderTraversalOutput3(node->left, fout, fp);
-    postOrderTraversalOutput3(node->right, fout, fp);
-
-    if (node->type==LEAF) {
-        fout << node->label << "(" << std::scientific << node->capacitance << ")\n";
-        //cout << "Leaf Node total capacitance: " << node->total_capacitance << endl;
-        //cout << "Leaf Node elmore capacitance: " << node->elmore_capacitance << endl;
-        //cout << "Leaf Node elmore delay: " << node->elmore_delay << endl;
-        fwrite(&(node->label), sizeof(int), 1, fp);
-        fwrite(&(node->capacitance), sizeof(double), 1, fp);
-
-
 
-    } else if (node->type==BRIDGE){
-        //cout << "Non-Leaf Node total capacitance: " << node->total_capacitance << endl;
-        //cout << "Non-Leaf Node elmore capacitance: " << node->elmore_capacitance << endl;
-        //cout << "Non-Leaf Node elmore delay: " << node->elmore_delay << endl;
-        int i = -1;
-        int j = 0;
-        fwrite(&(i), sizeof(int), 1, fp);
-        fwrite(&(node->leftWire), sizeof(double), 1, fp);
-        fwrite(&(node->rightWire), sizeof(double), 1, fp);
-        fwrite(&(j), sizeof(int), 1, fp);
-        fout << "(" << std::scientific << node->leftWire << " " << node->rightWire << " 0)\n";
+    // every output is attempted; a failed one makes the run fail at the end
+    int ok = 1;
+    if (from_snapshot) {
+        // the delays are in the snapshot already
+        ok &= snapshot.writePre(ctx, tree, out_name1);
+        ok &= writeDelays(ctx, tree, out_name2);
+    } else if (corners.empty() && ctx.pipeline) {
+        // out1 only reads what the Elmore pass leaves alone; insertion
+        // changes the wires, so it waits for out1 but not for out2
+        int out1_ok = 0;
+        std::thread out1([&] { out1_ok = writePre(ctx, tree, out_name1); });
+        if (!out2.open(out_name2, ctx.io, ctx.index_delays, true)) {
+            std::cout << "Error: cannot open file\n";
+            out1.join();
+            return 1;
+        }
+        elmoreDelay(ctx, tree, out2, pool.get());
+        out1.join();
+        ok &= out1_ok;
+    } else if (corners.empty()) {
+        ok &= writePre(ctx, tree, out_name1);
+        ok &= elmoreDelay(ctx, tree, out_name2, pool.get());
     } else {
-
-        int i = -1;
-        int j = 1;
-        double neg = -1;
-        fwrite(&(i), sizeof(int), 1, fp);
-        fwrite(&(node->leftWire), sizeof(double), 1, fp);
-        fwrite(&(neg), sizeof(double), 1, fp);
-        fwrite(&(j), sizeof(int), 1, fp);
-        fout << "(" << std::scientific << node->leftWire << " " << node->rightWire << " 1)\n";
-
+        ok &= writePre(ctx, tree, out_name1);
+        // out2 for the first corner, out2.c1, out2.c2, ... for the others
+        std::vector<std::string> names;
+        for (size_t k = 0; k < corners.size(); k++) {
+            names.push_back(k == 0 ? out_name2 : out_name2 + ".c" + std::to_string(k));
+        }
+        ok &= elmoreDelayCorners(tree, corners, names);
     }
 
-}
-
-int write3rdOutputPost(Node * root, const std::string& filename, const std::string& filename2) {
-    std::ofstream fout(filename);
-    if (!fout) {
-        //cout << "Unable to open file.\n";
-        return 0;
+    if (!eco_edits.empty()) {
+        // out2 again after the edits; insertion then works on the edited tree
+        if (!out2.close()) {
+            std::cout << "Error: cannot write " << out_name2 << "\n";
+            return 1;
+        }
+        EcoSession eco(ctx, tree);
+        if (!applyEcoFile(eco, eco_edits, out_name2)) {
+            return 1;
+        }
     }
-
-    FILE* fp = fopen(filename2.c_str(), "wb");  // convert std::string to const char*
-    if (!fp) {
-        std::cout << "Error: cannot open file\n";
-        return 0;
+    if (!save_snapshot.empty() && !saveSnapshot(ctx, tree, save_snapshot)) {
+        return 1;
     }
+    
+    if (sweep) {
+        // one task per constraint, each on its own copy of the tree
+        std::vector<int> inverters(constraints.size());
+        for (size_t k = 0; k < constraints.size(); k++) {
+            auto run = [&, k] {
+                std::string name3, name4;
+                if (sweep_outputs) {
+                    name3 = out_name3 + "." + constraint_names[k];
+                    name4 = out_name4 + "." + constraint_names[k];
+                }
+                inverters[k] = sweepConstraint(ctx, tree, constraints[k], name3, name4);
+            };
+            if (pool) {
+                pool->spawn(run);
+            } else {
+                run();
+            }
+        }
+        if (pool) {
+            pool->wait();
+        }
 
-    postOrderTraversalOutput3(root, fout, fp);
-    fout << "(" << std::scientific << (double) 0 << " " << (double)-1 << " 1)\n";
-    int i = -1;
-    int j = 1;
-    double zero = 0;
-    double neg = -1;
-    fwrite(&(i), sizeof(int), 1, fp);
-    fwrite(&(zero), sizeof(double), 1, fp);
-    fwrite(&(neg), sizeof(double), 1, fp);
-    fwrite(&(j), sizeof(int), 1, fp);
+        cout << "constraint inverters\n";
+        for (size_t k = 0; k < constraints.size(); k++) {
+            cout << constraint_names[k] << " " << inverters[k] << "\n";
+            ok &= inverters[k] >= 0;
+        }
+    } else {
+        int new_root;
+        if (from_snapshot && snapshot.inserted()) {
+            new_root = snapshot.insertedRoot();
+        } else if (!save_snapshot_inserted.empty()) {
+            // insertion cuts the parsed wires, out1 of the snapshot needs them
+            std::vector<double> parsed_left(tree.leftWire.begin(), tree.leftWire.begin() + tree.parsed);
+            std::vector<double> parsed_right(tree.rightWire.begin(), tree.rightWire.begin() + tree.parsed);
+            new_root = inverterInsertion(ctx, tree, pool.get());
+            if (new_root < 0 || !saveSnapshot(ctx, tree, save_snapshot_inserted, new_root, parsed_left.data(), parsed_right.data())) {
+                return 1;
+            }
+        } else {
+            new_root = inverterInsertion(ctx, tree, pool.get());
+        }
+        if (new_root < 0) {
+            return 1;
+        }
 
-    if (root->polarity==0){
-        //cout << "here\n";
-        fout << "(" << std::scientific << (double) 0 << " " << (double)-1 << " 1)\n";
-        fwrite(&(i), sizeof(int), 1, fp);
-        fwrite(&(zero), sizeof(double), 1, fp);
-        fwrite(&(neg), sizeof(double), 1, fp);
-        fwrite(&(j), sizeof(int), 1, fp);
-       
+        ok &= write3rdOutputPost(ctx, tree, new_root, out_name3, out_name4);
     }
-    fout.close();   // closes the std::ofstream
-    fclose(fp);     // closes the FILE* handle
-
-    return 1;
-}
-
-void freeMyTree(Node * node) {
-    if(!node) {
-        return;
+    if (!out2.close()) {
+        std::cout << "Error: cannot write " << out_name2 << "\n";
+        ok = 0;
     }
 
-    freeMyTree(node->left);
-    freeMyTree(node->right);
-
-    delete node;
-
-}
-int main(int argc, char **argv) {
-    if (argc != 9) {
-        std::cout << "Invalid number of arguments";
-        return 2;
+    freeMyTree(tree, arena);
+    writeDiagnostics(profile, chrome_trace, trace_log);
+    if (stats) {
+        printPeakMemory();
     }
-
-    time_constraint = atof(argv[1]);    
-    std::string in_name1 = argv[2];
-    std::string in_name2 = argv[3];
-    std::string in_name3 = argv[4];
-    std::string out_name1 = argv[5];
-    std::string out_name2 = argv[6];
-    std::string out_name3 = argv[7];
-    std::string out_name4 = argv[8];
-
-    storeWireParams(in_name2);
-    storeInvParams(in_name1);
-
-    /*
-    cout << "Unit resistance: " << std::scientific << unit_wire_res << endl;
-    cout << "Unit capacitance: " << std::scientific << unit_wire_cap << endl;
-    cout << "Inverter Input Capacitance: " << std::scientific << inv_input_cap << endl;
-    cout << "Inverter Output Capacitance: " << std::scientific << inv_output_cap << endl;
-    cout << "Inverter Output Resistance: " << std::scientific << inv_output_res << endl;
-    */
-
-    Node * tree = parseTree(in_name3);
-
-   // result =    }
-    writePre(tree, out_name1);
-
-
-    elmoreDelay(tree, out_name2);
-    
-    //result = writePre(tree, out_name1);
-    Node * new_tree =inverterInsertion(tree);
-
-    write3rdOutputPost(new_tree, out_name3, out_name4);
-    //debugPreStart(tree);
-
-    //freeMyTree(tree);
-    //freeMyTree(new_tree);
-
+    return ok ? 0 : 1;
 }
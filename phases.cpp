@@ -0,0 +1,306 @@
+// Times the four phases of a run separately on synthetic nets from
+// pa1_gentree: parseTree, elmoreDelay, inverterInsertion and
+// write3rdOutputPost. For each net it prints ns per parsed node for every
+// phase, the peak RSS and how many heap allocations the run made (node
+// storage comes from the Arena and is not counted; its size is listed).
+//
+//   ./pa1_phases [--large] [--repeats N] [--baseline FILE] [--save FILE]
+//
+// The nets are written to /tmp/pa1_phases once and reused. --large adds the
+// 10M sink nets. Every net runs in its own child process, so the peak RSS is
+// that net's alone; with --repeats the fastest run of each phase is kept.
+//
+// --save writes the ns/node figures to FILE. --baseline reads such a file and
+// flags every phase that got more than 25% slower; the exit status is then 1.
+// Baselines only make sense on the machine they were saved on.
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <map>
+#include <new>
+#include <string>
+#include <vector>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "tree.h"
+using namespace std;
+
+// ---- allocation counting ----
+
+static std::atomic<long> allocations{0};
+
+void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+void operator delete(void* p) noexcept {
+    free(p);
+}
+
+void operator delete(void* p, size_t) noexcept {
+    free(p);
+}
+
+// ---- one net ----
+
+enum Phase { PARSE, DELAY, INSERT, WRITE, PHASES };
+static const char* phase_names[PHASES] = {"parse", "delay", "insert", "write3"};
+
+struct Case {
+    std::string shape;
+    long sinks;
+    bool long_wires;
+
+    std::string name() const {
+        return shape + (long_wires ? "-long-" : "-") + std::to_string(sinks);
+    }
+};
+
+// what a child reports back through the pipe
+struct Result {
+    int ok;
+    int nodes;
+    int inverters;
+    double ns_per_node[PHASES];
+    long allocations;
+    double arena_mb;
+    double peak_mb;
+};
+
+static Result runPhases(const Context& ctx, const std::string& input) {
+    Result r;
+    memset(&r, 0, sizeof(r));
+    allocations = 0;
+
+    double secs[PHASES];
+    auto start = chrono::steady_clock::now();
+    auto lap = [&](Phase p) {
+        auto now = chrono::steady_clock::now();
+        secs[p] = chrono::duration<double>(now - start).count();
+        start = now;
+    };
+
+    Arena arena;
+    Tree tree(&arena);
+    if (!parseTree(ctx, input, tree)) {
+        return r;
+    }
+    lap(PARSE);
+    elmoreDelay(ctx, tree, "/dev/null");
+    lap(DELAY);
+    int root = inverterInsertion(ctx, tree);
+    if (root < 0) {
+        return r;
+    }
+    lap(INSERT);
+    write3rdOutputPost(ctx, tree, root, "/dev/null", "/dev/null");
+    lap(WRITE);
+
+    r.ok = 1;
+    r.nodes = tree.parsed;
+    r.inverters = tree.size() - tree.parsed;
+    for (int p = 0; p < PHASES; p++) {
+        r.ns_per_node[p] = secs[p] * 1e9 / tree.parsed;
+    }
+    r.allocations = allocations;
+    r.arena_mb = arena.reserved() / 1e6;
+    struct rusage usage;
+    getrusage(RUSAGE_SELF, &usage);
+    r.peak_mb = usage.ru_maxrss / 1024.0;
+    freeMyTree(tree, arena);
+    return r;
+}
+
+static Result runInChild(const Context& ctx, const std::string& input) {
+    Result r;
+    memset(&r, 0, sizeof(r));
+    int fds[2];
+    if (pipe(fds) != 0) {
+        return r;
+    }
+    cout.flush();
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(fds[0]);
+        Result child = runPhases(ctx, input);
+        ssize_t n = write(fds[1], &child, sizeof(child));
+        _exit(n == (ssize_t) sizeof(child) ? 0 : 1);
+    }
+    close(fds[1]);
+    if (pid < 0 || read(fds[0], &r, sizeof(r)) != (ssize_t) sizeof(r)) {
+        r.ok = 0;
+    }
+    close(fds[0]);
+    if (pid > 0) {
+        waitpid(pid, nullptr, 0);
+    }
+    return r;
+}
+
+// writes the net with pa1_gentree unless it is there already
+static int generate(const std::string& gentree, const Case& c, const std::string& path) {
+    struct stat st;
+    if (stat(path.c_str(), &st) == 0) {
+        return 1;
+    }
+    std::string cmd = gentree + " " + c.shape + " " + std::to_string(c.sinks) + " " + path +
+                      (c.long_wires ? " --long-wires" : "");
+    if (system(cmd.c_str()) != 0) {
+        cout << "Unable to generate " << path << endl;
+        unlink(path.c_str());
+        return 0;
+    }
+    return 1;
+}
+
+// ---- baselines: "case phase ns/node" per line ----
+
+static std::map<std::string, double> readBaseline(const std::string& filename) {
+    std::map<std::string, double> baseline;
+    std::ifstream in(filename);
+    std::string name, phase;
+    double ns;
+    while (in >> name >> phase >> ns) {
+        baseline[name + " " + phase] = ns;
+    }
+    return baseline;
+}
+
+int main(int argc, char** argv) {
+    bool large = false;
+    int repeats = 1;
+    std::string baseline_file, save_file;
+    for (int a = 1; a < argc; a++) {
+        if (strcmp(argv[a], "--large") == 0) {
+            large = true;
+        } else if (strcmp(argv[a], "--repeats") == 0 && a + 1 < argc) {
+            repeats = std::max(1, atoi(argv[++a]));
+        } else if (strcmp(argv[a], "--baseline") == 0 && a + 1 < argc) {
+            baseline_file = argv[++a];
+        } else if (strcmp(argv[a], "--save") == 0 && a + 1 < argc) {
+            save_file = argv[++a];
+        } else {
+            printf("Usage: %s [--large] [--repeats N] [--baseline FILE] [--save FILE]\n", argv[0]);
+            return 2;
+        }
+    }
+
+    // pa1_gentree is built next to this binary
+    std::string self = argv[0];
+    size_t slash = self.rfind('/');
+    std::string gentree = (slash == std::string::npos ? std::string("./") : self.substr(0, slash + 1)) +
+                          "pa1_gentree";
+
+    // examples/wire.param and examples/inv.param
+    Context ctx;
+    ctx.unit_wire_res = 1.0e-04;
+    ctx.unit_wire_cap = 2.0e-19;
+    ctx.inv_input_cap = 3.45e-14;
+    ctx.inv_output_cap = 5.8e-14;
+    ctx.inv_output_res = 113;
+    ctx.time_constraint = 3e-10;
+
+    std::vector<long> sizes = {1000, 100000, 1000000};
+    if (large) {
+        sizes.push_back(10000000);
+    }
+    std::vector<Case> cases;
+    for (long sinks : sizes) {
+        for (const char* shape : {"balanced", "htree", "random", "chain"}) {
+            cases.push_back({shape, sinks, false});
+        }
+        cases.push_back({"balanced", sinks, true});
+    }
+
+    std::string dir = "/tmp/pa1_phases";
+    mkdir(dir.c_str(), 0755);
+
+    std::map<std::string, double> baseline;
+    if (!baseline_file.empty()) {
+        baseline = readBaseline(baseline_file);
+        if (baseline.empty()) {
+            cout << "No baseline in " << baseline_file << endl;
+        }
+    }
+    std::ofstream save;
+    if (!save_file.empty()) {
+        save.open(save_file);
+        if (!save) {
+            cout << "Unable to open file." << endl;
+            return 1;
+        }
+    }
+
+    printf("%-22s %9s %9s %8s %8s %8s %8s %9s %8s %8s\n", "net", "nodes", "inverters", "parse",
+           "delay", "insert", "write3", "allocs", "arena MB", "peak MB");
+    printf("%-22s %9s %9s %8s %8s %8s %8s\n", "", "", "", "ns/node", "ns/node", "ns/node", "ns/node");
+    int regressions = 0;
+    std::vector<std::string> flagged;
+    for (const Case& c : cases) {
+        std::string path = dir + "/" + c.name() + ".txt";
+        if (!generate(gentree, c, path)) {
+            return 1;
+        }
+        Result best;
+        memset(&best, 0, sizeof(best));
+        for (int k = 0; k < repeats; k++) {
+            Result r = runInChild(ctx, path);
+            if (!r.ok) {
+                cout << c.name() << " failed" << endl;
+                return 1;
+            }
+            if (k == 0) {
+                best = r;
+                continue;
+            }
+            for (int p = 0; p < PHASES; p++) {
+                best.ns_per_node[p] = std::min(best.ns_per_node[p], r.ns_per_node[p]);
+            }
+        }
+        printf("%-22s %9d %9d %8.1f %8.1f %8.1f %8.1f %9ld %8.0f %8.0f\n", c.name().c_str(), best.nodes,
+               best.inverters, best.ns_per_node[PARSE], best.ns_per_node[DELAY], best.ns_per_node[INSERT],
+               best.ns_per_node[WRITE], best.allocations, best.arena_mb, best.peak_mb);
+
+        for (int p = 0; p < PHASES; p++) {
+            std::string key = c.name() + " " + phase_names[p];
+            if (save) {
+                save << key << " " << best.ns_per_node[p] << "\n";
+            }
+            auto it = baseline.find(key);
+            // the 1K nets run in microseconds, too noisy to compare
+            if (it == baseline.end() || c.sinks < 100000) {
+                continue;
+            }
+            double ratio = best.ns_per_node[p] / it->second;
+            if (ratio > 1.25) {
+                char line[128];
+                snprintf(line, sizeof(line), "%s: %.1f ns/node, %.2fx the baseline %.1f", key.c_str(),
+                         best.ns_per_node[p], ratio, it->second);
+                flagged.push_back(line);
+                regressions++;
+            }
+        }
+    }
+
+    if (!baseline.empty()) {
+        if (regressions == 0) {
+            printf("\nno regressions against %s\n", baseline_file.c_str());
+        } else {
+            printf("\n%d regressions against %s\n", regressions, baseline_file.c_str());
+            for (const std::string& line : flagged) {
+                printf("  %s\n", line.c_str());
+            }
+        }
+    }
+    return regressions ? 1 : 0;
+}
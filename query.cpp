@@ -0,0 +1,103 @@
+// Looks up sink delays in an out2 file, plain or indexed.
+//
+//   ./pa1_query out2                every sink in file order
+//   ./pa1_query out2 --top N        the N slowest sinks (at most 100)
+//   ./pa1_query out2 LABEL...       the sinks with these labels
+//   ./pa1_query out2 --compare OTHER [--ulps N]
+//                                   same sinks in the same order as OTHER,
+//                                   every delay within N units in the last
+//                                   place of it (default 0, bit for bit)
+//
+// Each sink is printed as "label delay"; a summary line with the number of
+// sinks, the delay range and the skew comes first. --compare prints the
+// largest difference instead and fails on any sink out of tolerance.
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include "delayfile.h"
+
+// units in the last place between two delays of the same sign
+static int64_t ulpDistance(double a, double b) {
+    int64_t x, y;
+    memcpy(&x, &a, sizeof(x));
+    memcpy(&y, &b, sizeof(y));
+    if ((x < 0) != (y < 0)) {
+        return a == b ? 0 : INT64_MAX;
+    }
+    return x > y ? x - y : y - x;
+}
+
+static int compare(const DelayFile& file, const char* other_name, int64_t ulps) {
+    DelayFile other;
+    if (!other.open(other_name)) {
+        return 1;
+    }
+    if (other.size() != file.size()) {
+        printf("%zu sinks against %zu\n", file.size(), other.size());
+        return 1;
+    }
+    int64_t worst = 0;
+    size_t over = 0;
+    for (size_t i = 0; i < file.size(); i++) {
+        if (file[i].label != other[i].label) {
+            printf("sink %zu is %d against %d\n", i, file[i].label, other[i].label);
+            return 1;
+        }
+        int64_t d = ulpDistance(file[i].delay, other[i].delay);
+        worst = std::max(worst, d);
+        over += d > ulps;
+    }
+    printf("largest difference %lld ulps, %zu sinks over %lld\n", (long long) worst, over, (long long) ulps);
+    return over ? 1 : 0;
+}
+
+int main(int argc, char** argv) {
+    if (argc < 2) {
+        printf("Usage: %s out2 [--top N | --compare OTHER [--ulps N] | LABEL...]\n", argv[0]);
+        return 2;
+    }
+    DelayFile file;
+    if (!file.open(argv[1])) {
+        return 1;
+    }
+    if (argc >= 4 && strcmp(argv[2], "--compare") == 0) {
+        int64_t ulps = 0;
+        if (argc == 6 && strcmp(argv[4], "--ulps") == 0) {
+            ulps = atoll(argv[5]);
+        } else if (argc != 4) {
+            printf("Usage: %s out2 --compare OTHER [--ulps N]\n", argv[0]);
+            return 2;
+        }
+        return compare(file, argv[3], ulps);
+    }
+    printf("sinks %zu min %e max %e skew %e\n", file.size(), file.minDelay(), file.maxDelay(),
+           file.maxDelay() - file.minDelay());
+
+    if (argc == 2) {
+        for (size_t i = 0; i < file.size(); i++) {
+            printf("%d %e\n", file[i].label, file[i].delay);
+        }
+        return 0;
+    }
+    if (strcmp(argv[2], "--top") == 0 && argc == 4) {
+        size_t n = std::min((size_t) atol(argv[3]), file.slowestCount());
+        for (size_t k = 0; k < n; k++) {
+            const DelayRecord& r = file[file.slowest(k)];
+            printf("%d %e\n", r.label, r.delay);
+        }
+        return 0;
+    }
+
+    int missing = 0;
+    for (int a = 2; a < argc; a++) {
+        long pos = file.find(atoi(argv[a]));
+        if (pos < 0) {
+            printf("%s not found\n", argv[a]);
+            missing++;
+        } else {
+            printf("%d %e\n", file[pos].label, file[pos].delay);
+        }
+    }
+    return missing ? 1 : 0;
+}
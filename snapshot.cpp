@@ -0,0 +1,253 @@
+#include "snapshot.h"
+#include <climits>
+#include <cstring>
+#include <iostream>
+#include <vector>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+using namespace std;
+
+static const char snapshot_magic[8] = {'P', 'A', '1', 'S', 'N', 'A', 'P', '1'};
+
+static size_t align64(size_t n) {
+    return (n + 63) & ~(size_t) 63;
+}
+
+// bytes per element of every column
+static size_t elementSize(SnapshotColumn c) {
+    switch (c) {
+    case SNAP_TYPE:
+        return sizeof(NodeType);
+    case SNAP_LABEL:
+    case SNAP_LEFT:
+    case SNAP_RIGHT:
+    case SNAP_POLARITY:
+        return sizeof(int);
+    default:
+        return sizeof(double);
+    }
+}
+
+// the links below top reach every node at most once, so they hold no cycle
+// and no node with two parents
+static bool isTreeBelow(const int* left, const int* right, int64_t nodes, int64_t top) {
+    std::vector<char> seen(nodes, 0);
+    std::vector<int> st;
+    st.push_back((int) top);
+    while (!st.empty()) {
+        int node = st.back();
+        st.pop_back();
+        if (seen[node]) {
+            return false;
+        }
+        seen[node] = 1;
+        if (left[node] >= 0) st.push_back(left[node]);
+        if (right[node] >= 0) st.push_back(right[node]);
+    }
+    return true;
+}
+
+int saveSnapshot(const Context& ctx, const Tree& tree, const std::string& filename, int inserted_root,
+                 const double* parsed_left_wire, const double* parsed_right_wire) {
+    if (tree.shared()) {
+        cout << "Shared trees cannot be saved as a snapshot" << endl;
+        return 0;
+    }
+    BufferedWriter out;
+    if (!out.open(filename, ctx.io)) {
+        cout << "Unable to open file." << endl;
+        return 0;
+    }
+
+    const void* data[SNAP_COLUMNS] = {
+        tree.type.data(), tree.label.data(), tree.capacitance.data(), tree.leftWire.data(),
+        tree.rightWire.data(), tree.left.data(), tree.right.data(), tree.total_capacitance.data(),
+        tree.elmore_capacitance.data(), tree.elmore_delay.data(), tree.cut_wire.data(), tree.polarity.data(),
+        parsed_left_wire, parsed_right_wire,
+    };
+
+    SnapshotHeader h;
+    memset(&h, 0, sizeof(h));
+    memcpy(h.magic, snapshot_magic, sizeof(h.magic));
+    h.nodes = tree.size();
+    h.parsed = tree.parsed;
+    h.root = tree.root;
+    h.inserted_root = inserted_root;
+    h.unit_wire_res = ctx.unit_wire_res;
+    h.unit_wire_cap = ctx.unit_wire_cap;
+    h.inv_input_cap = ctx.inv_input_cap;
+    h.inv_output_cap = ctx.inv_output_cap;
+    h.inv_output_res = ctx.inv_output_res;
+    h.time_constraint = ctx.time_constraint;
+    h.engine = ctx.engine;
+
+    size_t count[SNAP_COLUMNS];
+    size_t offset = align64(sizeof(h));
+    for (int c = 0; c < SNAP_COLUMNS; c++) {
+        bool parsed_wire = c == SNAP_PARSED_LEFT_WIRE || c == SNAP_PARSED_RIGHT_WIRE;
+        count[c] = parsed_wire ? (inserted_root >= 0 ? h.parsed : 0) : h.nodes;
+        if (count[c] > 0) {
+            h.columns[c] = offset;
+            offset = align64(offset + count[c] * elementSize((SnapshotColumn) c));
+        }
+    }
+
+    const char zeros[64] = {};
+    out.put(&h, sizeof(h));
+    size_t written = sizeof(h);
+    for (int c = 0; c < SNAP_COLUMNS; c++) {
+        if (count[c] == 0) {
+            continue;
+        }
+        out.put(zeros, h.columns[c] - written);
+        out.put(data[c], count[c] * elementSize((SnapshotColumn) c));
+        written = h.columns[c] + count[c] * elementSize((SnapshotColumn) c);
+    }
+    return out.close();
+}
+
+int isSnapshot(const std::string& filename) {
+    char magic[sizeof(snapshot_magic)] = {};
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return 0;
+    }
+    ssize_t got = pread(fd, magic, sizeof(magic), 0);
+    ::close(fd);
+    return got == (ssize_t) sizeof(magic) && memcmp(magic, snapshot_magic, sizeof(magic)) == 0;
+}
+
+Snapshot::~Snapshot() {
+    if (map) {
+        munmap(const_cast<char*>(map), map_size);
+    }
+}
+
+int Snapshot::open(const std::string& filename) {
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if (fd < 0) {
+        cout << "Unable to open file" << endl;
+        return 0;
+    }
+    struct stat st;
+    if (fstat(fd, &st) != 0 || (size_t) st.st_size < sizeof(SnapshotHeader)) {
+        ::close(fd);
+        cout << "Not a snapshot" << endl;
+        return 0;
+    }
+    void* p = mmap(nullptr, st.st_size, PROT_READ, MAP_PRIVATE | MAP_POPULATE, fd, 0);
+    ::close(fd);
+    if (p == MAP_FAILED) {
+        return 0;
+    }
+    map = static_cast<const char*>(p);
+    map_size = st.st_size;
+    header = reinterpret_cast<const SnapshotHeader*>(map);
+
+    if (memcmp(header->magic, snapshot_magic, sizeof(snapshot_magic)) != 0) {
+        cout << "Not a snapshot" << endl;
+        return 0;
+    }
+    for (int c = 0; c < SNAP_COLUMNS; c++) {
+        bool parsed_wire = c == SNAP_PARSED_LEFT_WIRE || c == SNAP_PARSED_RIGHT_WIRE;
+        if (parsed_wire && !inserted()) {
+            continue;
+        }
+        size_t n = parsed_wire ? header->parsed : header->nodes;
+        if (header->columns[c] == 0 || header->columns[c] > map_size || header->columns[c] % 64 != 0 ||
+            n > (map_size - header->columns[c]) / elementSize((SnapshotColumn) c)) {
+            cout << "Snapshot is cut short" << endl;
+            return 0;
+        }
+    }
+
+    // everything restore() and the passes after it follow has to stay in the tree
+    if (header->nodes > (uint64_t) INT_MAX) {
+        cout << "Snapshot is corrupt" << endl;
+        return 0;
+    }
+    int64_t nodes = (int64_t) header->nodes;
+    if (header->parsed > header->nodes || header->root < 0 || header->root >= nodes ||
+        header->inserted_root < -1 || header->inserted_root >= nodes) {
+        cout << "Snapshot is corrupt" << endl;
+        return 0;
+    }
+    const NodeType* type = column<NodeType>(SNAP_TYPE);
+    const int* left = column<int>(SNAP_LEFT);
+    const int* right = column<int>(SNAP_RIGHT);
+    int64_t parsed = (int64_t) header->parsed;
+    for (int64_t i = 0; i < nodes; i++) {
+        if (type[i] > INV || left[i] < -1 || left[i] >= nodes || right[i] < -1 || right[i] >= nodes) {
+            cout << "Snapshot is corrupt" << endl;
+            return 0;
+        }
+        bool shape = type[i] == LEAF     ? left[i] == -1 && right[i] == -1
+                     : type[i] == BRIDGE ? left[i] >= 0 && right[i] >= 0
+                                         : left[i] >= 0 && right[i] == -1;
+        // parsed nodes are in post-order; insertion only links them to the
+        // inverters after them
+        if (i < parsed) {
+            shape = shape && (left[i] < i || (inserted() && left[i] >= parsed)) &&
+                    (right[i] < i || (inserted() && right[i] >= parsed));
+        }
+        if (!shape) {
+            cout << "Snapshot is corrupt" << endl;
+            return 0;
+        }
+    }
+    if (!isTreeBelow(left, right, nodes, header->root) ||
+        (inserted() && !isTreeBelow(left, right, nodes, header->inserted_root))) {
+        cout << "Snapshot is corrupt" << endl;
+        return 0;
+    }
+    return 1;
+}
+
+int Snapshot::matches(const Context& ctx) const {
+    if (header->unit_wire_res != ctx.unit_wire_res || header->unit_wire_cap != ctx.unit_wire_cap ||
+        header->inv_input_cap != ctx.inv_input_cap || header->inv_output_cap != ctx.inv_output_cap ||
+        header->inv_output_res != ctx.inv_output_res) {
+        cout << "The snapshot was analyzed with other wire or inverter parameters" << endl;
+        return 0;
+    }
+    if (inserted() && (header->time_constraint != ctx.time_constraint || header->engine != (uint32_t) ctx.engine)) {
+        cout << "The snapshot was taken after insertion with another constraint or engine" << endl;
+        return 0;
+    }
+    return 1;
+}
+
+void Snapshot::restore(Tree& tree) const {
+    size_t n = header->nodes;
+    tree.type.assign(column<NodeType>(SNAP_TYPE), column<NodeType>(SNAP_TYPE) + n);
+    tree.label.assign(column<int>(SNAP_LABEL), column<int>(SNAP_LABEL) + n);
+    tree.capacitance.assign(column<double>(SNAP_CAPACITANCE), column<double>(SNAP_CAPACITANCE) + n);
+    tree.leftWire.assign(column<double>(SNAP_LEFT_WIRE), column<double>(SNAP_LEFT_WIRE) + n);
+    tree.rightWire.assign(column<double>(SNAP_RIGHT_WIRE), column<double>(SNAP_RIGHT_WIRE) + n);
+    tree.left.assign(column<int>(SNAP_LEFT), column<int>(SNAP_LEFT) + n);
+    tree.right.assign(column<int>(SNAP_RIGHT), column<int>(SNAP_RIGHT) + n);
+    tree.total_capacitance.assign(column<double>(SNAP_TOTAL_CAPACITANCE),
+                                  column<double>(SNAP_TOTAL_CAPACITANCE) + n);
+    tree.elmore_capacitance.assign(column<double>(SNAP_ELMORE_CAPACITANCE),
+                                   column<double>(SNAP_ELMORE_CAPACITANCE) + n);
+    tree.elmore_delay.assign(column<double>(SNAP_ELMORE_DELAY), column<double>(SNAP_ELMORE_DELAY) + n);
+    tree.cut_wire.assign(column<double>(SNAP_CUT_WIRE), column<double>(SNAP_CUT_WIRE) + n);
+    tree.polarity.assign(column<int>(SNAP_POLARITY), column<int>(SNAP_POLARITY) + n);
+    tree.root = (int) header->root;
+    tree.parsed = (int) header->parsed;
+}
+
+int Snapshot::writePre(const Context& ctx, const Tree& tree, const std::string& filename) const {
+    if (!inserted()) {
+        return ::writePre(ctx, tree, filename);
+    }
+    BufferedWriter fout;
+    if (!fout.open(filename, ctx.io)) {
+        cout << "Unable to open file.\n";
+        return 0;
+    }
+    preOrderTraversal(tree, fout, column<double>(SNAP_PARSED_LEFT_WIRE), column<double>(SNAP_PARSED_RIGHT_WIRE));
+    return fout.close();
+}
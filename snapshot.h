@@ -0,0 +1,106 @@
+#ifndef SNAPSHOT_H
+#define SNAPSHOT_H
+
+#include <cstdint>
+#include <string>
+#include "tree.h"
+
+// Image of an analyzed tree, so a later run can skip the parse and the
+// Elmore pass (for instance to try other constraints). It is taken either
+// after the Elmore pass or after insertion as well. The layout is a header
+// and then every Tree array as one section, each 64-byte aligned and found
+// by its file offset, so the file is position independent and is read
+// straight from an mmap.
+//
+// The delays only hold for the wire and inverter parameters they were
+// computed with, so a snapshot is only used with the same ones; one taken
+// after insertion also needs the same constraint and engine.
+
+enum SnapshotColumn {
+    SNAP_TYPE,
+    SNAP_LABEL,
+    SNAP_CAPACITANCE,
+    SNAP_LEFT_WIRE,
+    SNAP_RIGHT_WIRE,
+    SNAP_LEFT,
+    SNAP_RIGHT,
+    SNAP_TOTAL_CAPACITANCE,
+    SNAP_ELMORE_CAPACITANCE,
+    SNAP_ELMORE_DELAY,
+    SNAP_CUT_WIRE,
+    SNAP_POLARITY,
+    // after insertion only: both wires of the parsed nodes as they were
+    // parsed, which insertion shortens and out1 still needs
+    SNAP_PARSED_LEFT_WIRE,
+    SNAP_PARSED_RIGHT_WIRE,
+    SNAP_COLUMNS
+};
+
+struct SnapshotHeader {
+    char magic[8];              // "PA1SNAP1"
+    uint64_t nodes;
+    uint64_t parsed;
+    int64_t root;
+    int64_t inserted_root;      // root after insertion, -1 if taken before
+    double unit_wire_res;       // the Context the tree was analyzed with
+    double unit_wire_cap;
+    double inv_input_cap;
+    double inv_output_cap;
+    double inv_output_res;
+    double time_constraint;
+    uint32_t engine;
+    uint32_t unused;
+    uint64_t columns[SNAP_COLUMNS];   // file offsets, 0 if not present
+};
+
+// Writes tree as it is after the Elmore pass. After insertion, inserted_root
+// is the new root and parsed_left_wire/parsed_right_wire are copies of the
+// tree's wires from before insertion. Shared trees are not supported.
+// Returns 0 if the file cannot be written.
+int saveSnapshot(const Context& ctx, const Tree& tree, const std::string& filename, int inserted_root = -1,
+                 const double* parsed_left_wire = nullptr, const double* parsed_right_wire = nullptr);
+
+// does the file start like a snapshot
+int isSnapshot(const std::string& filename);
+
+// A mapped snapshot. restore() copies the arrays into a Tree in one block
+// each, so there is no per-node work at all.
+class Snapshot {
+public:
+    Snapshot() = default;
+    ~Snapshot();
+
+    Snapshot(const Snapshot&) = delete;
+    Snapshot& operator=(const Snapshot&) = delete;
+
+    // returns 0 if the file is not a complete snapshot
+    int open(const std::string& filename);
+
+    // returns 0, and says why, if the snapshot was analyzed differently
+    int matches(const Context& ctx) const;
+
+    void restore(Tree& tree) const;
+
+    bool inserted() const {
+        return header->inserted_root >= 0;
+    }
+
+    int insertedRoot() const {
+        return (int) header->inserted_root;
+    }
+
+    // out1 of the parsed tree, also for a snapshot taken after insertion
+    int writePre(const Context& ctx, const Tree& tree, const std::string& filename) const;
+
+private:
+    const char* map = nullptr;
+    size_t map_size = 0;
+    const SnapshotHeader* header = nullptr;
+
+    template <class T>
+    const T* column(SnapshotColumn c) const {
+        return reinterpret_cast<const T*>(map + header->columns[c]);
+    }
+};
+
+#endif
@@ -0,0 +1,107 @@
+#include "taskpool.h"
+
+// which pool and worker the current thread belongs to
+static thread_local TaskPool* current_pool = nullptr;
+static thread_local int current_worker = 0;
+
+TaskPool::TaskPool(int threads) : pending(0), queued(0), stopping(false) {
+    if (threads < 1) {
+        threads = 1;
+    }
+    for (int i = 0; i < threads; i++) {
+        queues.push_back(std::make_unique<Queue>());
+    }
+    for (int i = 1; i < threads; i++) {
+        workers.emplace_back([this, i] { workerLoop(i); });
+    }
+}
+
+TaskPool::~TaskPool() {
+    {
+        std::lock_guard<std::mutex> lock(idle_m);
+        stopping = true;
+    }
+    idle_cv.notify_all();
+    for (std::thread& t : workers) {
+        t.join();
+    }
+}
+
+void TaskPool::spawn(std::function<void()> fn) {
+    int self = worker();
+    pending++;
+    {
+        std::lock_guard<std::mutex> lock(queues[self]->m);
+        queues[self]->tasks.push_back(std::move(fn));
+    }
+    queued++;
+    {
+        // pairs with the predicate check in workerLoop, so the wakeup is not lost
+        std::lock_guard<std::mutex> lock(idle_m);
+    }
+    idle_cv.notify_one();
+}
+
+int TaskPool::worker() const {
+    return (current_pool == this) ? current_worker : 0;
+}
+
+bool TaskPool::runOne(int self) {
+    std::function<void()> fn;
+    int n = size();
+
+    // own tasks newest first, then the oldest task of someone else
+    for (int k = 0; k < n && !fn; k++) {
+        Queue& q = *queues[(self + k) % n];
+        std::lock_guard<std::mutex> lock(q.m);
+        if (q.tasks.empty()) {
+            continue;
+        }
+        if (k == 0) {
+            fn = std::move(q.tasks.back());
+            q.tasks.pop_back();
+        } else {
+            fn = std::move(q.tasks.front());
+            q.tasks.pop_front();
+        }
+    }
+    if (!fn) {
+        return false;
+    }
+
+    queued--;
+    fn();
+    pending--;
+    return true;
+}
+
+void TaskPool::workerLoop(int self) {
+    current_pool = this;
+    current_worker = self;
+    while (true) {
+        if (runOne(self)) {
+            continue;
+        }
+        std::unique_lock<std::mutex> lock(idle_m);
+        idle_cv.wait(lock, [this] { return queued > 0 || stopping; });
+        if (stopping) {
+            return;
+        }
+    }
+}
+
+void TaskPool::wait() {
+    TaskPool* saved_pool = current_pool;
+    int saved_worker = current_worker;
+    current_pool = this;
+    current_worker = 0;
+
+    while (pending > 0) {
+        if (!runOne(0)) {
+            std::this_thread::yield();
+        }
+    }
+
+    current_pool = saved_pool;
+    current_worker = saved_worker;
+}
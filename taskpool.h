@@ -0,0 +1,106 @@
+#ifndef TASKPOOL_H
+#define TASKPOOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Work-stealing task pool. Every worker has its own deque: it pushes and pops
+// its own tasks at the back and steals from the front of the others when it
+// runs dry. The thread calling wait() takes part as worker 0, so a pool of
+// size 1 has no extra threads and runs everything on the caller.
+//
+// Tasks do not block on each other. A fork/join is written as two spawned
+// tasks plus a counter in the parent, and whichever child finishes last runs
+// the parent's part, so nesting depth never turns into stack depth.
+class TaskPool {
+public:
+    explicit TaskPool(int threads);
+    ~TaskPool();
+
+    TaskPool(const TaskPool&) = delete;
+    TaskPool& operator=(const TaskPool&) = delete;
+
+    int size() const {
+        return (int) queues.size();
+    }
+
+    // queues fn on the calling worker (worker 0 if called from outside)
+    void spawn(std::function<void()> fn);
+
+    // index of the calling thread in this pool, 0 if it is not one of ours;
+    // lets tasks pick per-worker scratch state
+    int worker() const;
+
+    // runs tasks on the calling thread until every spawned task has finished
+    void wait();
+
+private:
+    struct Queue {
+        std::mutex m;
+        std::deque<std::function<void()>> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    std::vector<std::thread> workers;
+
+    std::atomic<long> pending;   // spawned and not finished yet
+    std::atomic<long> queued;    // spawned and not started yet
+    std::atomic<bool> stopping;
+
+    std::mutex idle_m;
+    std::condition_variable idle_cv;
+
+    bool runOne(int self);
+    void workerLoop(int self);
+};
+
+// Hands items from one stage of a pipeline to the thread running the next.
+// At most capacity items wait at a time: push blocks while the queue is
+// full, so a fast producer cannot run further ahead of a slow consumer.
+template <class T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t cap) : capacity(cap) {}
+
+    void push(T item) {
+        std::unique_lock<std::mutex> lock(m);
+        not_full.wait(lock, [this] { return items.size() < capacity; });
+        items.push_back(std::move(item));
+        not_empty.notify_one();
+    }
+
+    // no more pushes; pop drains what is left
+    void close() {
+        std::lock_guard<std::mutex> lock(m);
+        closed = true;
+        not_empty.notify_all();
+    }
+
+    // returns false once the queue is closed and empty
+    bool pop(T& item) {
+        std::unique_lock<std::mutex> lock(m);
+        not_empty.wait(lock, [this] { return !items.empty() || closed; });
+        if (items.empty()) {
+            return false;
+        }
+        item = std::move(items.front());
+        items.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+
+private:
+    size_t capacity;
+    std::deque<T> items;
+    bool closed = false;
+    std::mutex m;
+    std::condition_variable not_full, not_empty;
+};
+
+#endif
@@ -0,0 +1,108 @@
+#include "trace.h"
+
+#if PA1_TRACE_LEVEL > 0
+
+#include <cstdarg>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include "writer.h"
+
+namespace trace {
+
+static const char* category_names[TRACE_CATEGORIES] = {"parse", "elmore", "segmentation", "polarity"};
+
+// seq is the position of the line plus one once it is complete, 0 while a
+// writer is filling the slot in
+struct Entry {
+    std::atomic<uint64_t> seq;
+    uint8_t category;
+    uint8_t level;
+    uint16_t thread;
+    char text[116];
+};
+
+std::atomic<unsigned> enabled{~0u};
+static Entry ring[capacity];
+static std::atomic<uint64_t> head{0};
+static std::atomic<int> next_thread{0};
+
+void record(TraceCategory category, int level, const char* format, ...) {
+    static thread_local int thread = next_thread++;
+    uint64_t n = head.fetch_add(1, std::memory_order_relaxed);
+    Entry& e = ring[n & (capacity - 1)];
+    e.seq.store(0, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_release);
+
+    e.category = (uint8_t) category;
+    e.level = (uint8_t) level;
+    e.thread = (uint16_t) thread;
+    va_list args;
+    va_start(args, format);
+    vsnprintf(e.text, sizeof(e.text), format, args);
+    va_end(args);
+
+    e.seq.store(n + 1, std::memory_order_release);
+}
+
+int parseCategories(const std::string& list, unsigned& mask) {
+    mask = 0;
+    size_t pos = 0;
+    while (pos <= list.size()) {
+        size_t comma = list.find(',', pos);
+        if (comma == std::string::npos) {
+            comma = list.size();
+        }
+        std::string name = list.substr(pos, comma - pos);
+        int c = 0;
+        while (c < TRACE_CATEGORIES && name != category_names[c]) {
+            c++;
+        }
+        if (c == TRACE_CATEGORIES) {
+            return 0;
+        }
+        mask |= 1u << c;
+        pos = comma + 1;
+    }
+    return 1;
+}
+
+int dump(const std::string& filename) {
+    BufferedWriter out;
+    if (!out.open(filename)) {
+        return 0;
+    }
+    uint64_t end = head.load(std::memory_order_acquire);
+    uint64_t begin = end > (uint64_t) capacity ? end - capacity : 0;
+    if (begin > 0) {
+        char line[64];
+        snprintf(line, sizeof(line), "... %llu older lines dropped\n", (unsigned long long) begin);
+        out.print(line);
+    }
+    for (uint64_t n = begin; n < end; n++) {
+        const Entry& e = ring[n & (capacity - 1)];
+        if (e.seq.load(std::memory_order_acquire) != n + 1) {
+            continue;   // overwritten or still being written
+        }
+        Entry copy;
+        copy.category = e.category;
+        copy.level = e.level;
+        copy.thread = e.thread;
+        memcpy(copy.text, e.text, sizeof(copy.text));
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (e.seq.load(std::memory_order_relaxed) != n + 1) {
+            continue;
+        }
+        char prefix[48];
+        snprintf(prefix, sizeof(prefix), "%s %s t%d: ", copy.level == 1 ? "info " : "debug",
+                 category_names[copy.category], copy.thread);
+        out.print(prefix);
+        out.print(copy.text);
+        out.print('\n');
+    }
+    return out.close();
+}
+
+}
+
+#endif
@@ -0,0 +1,77 @@
+#ifndef TRACE_H
+#define TRACE_H
+
+// Debug tracing of the passes, compiled in by level:
+//   make TRACE_LEVEL=1   PA1_TRACE_INFO, about one line per pass
+//   make TRACE_LEVEL=2   PA1_TRACE_DEBUG as well, one line per decision
+// At level 0, the default, both macros expand to nothing and their arguments
+// are never evaluated. PA1_TRACE_CATEGORIES, a bit mask over TraceCategory,
+// drops whole categories at compile time too.
+//
+// A message is formatted printf style into a fixed ring buffer that every
+// thread writes to without a lock; only the newest trace::capacity lines are
+// kept. trace::dump writes them out once the run is over.
+//
+//   PA1_TRACE_DEBUG(TRACE_POLARITY, "node %d: fixed on the right", node);
+
+enum TraceCategory {
+    TRACE_PARSE,
+    TRACE_ELMORE,
+    TRACE_SEGMENTATION,
+    TRACE_POLARITY,
+    TRACE_CATEGORIES
+};
+
+#ifndef PA1_TRACE_LEVEL
+#define PA1_TRACE_LEVEL 0
+#endif
+#ifndef PA1_TRACE_CATEGORIES
+#define PA1_TRACE_CATEGORIES 0xff
+#endif
+
+#if PA1_TRACE_LEVEL > 0
+
+#include <atomic>
+#include <string>
+
+namespace trace {
+
+const int capacity = 1 << 16;
+
+// categories to record at run time, within PA1_TRACE_CATEGORIES; all of them
+// unless set
+extern std::atomic<unsigned> enabled;
+
+void record(TraceCategory category, int level, const char* format, ...) __attribute__((format(printf, 3, 4)));
+
+// "parse,polarity" to a mask; returns 0 for an unknown name
+int parseCategories(const std::string& list, unsigned& mask);
+
+// the buffered lines, oldest first; returns 0 if the file cannot be written
+int dump(const std::string& filename);
+
+}
+
+#define PA1_TRACE_AT(level, category, ...)                                                              \
+    do {                                                                                                \
+        if (((PA1_TRACE_CATEGORIES >> (category)) & 1) &&                                               \
+            ((trace::enabled.load(std::memory_order_relaxed) >> (category)) & 1)) {                     \
+            trace::record(category, level, __VA_ARGS__);                                                \
+        }                                                                                               \
+    } while (0)
+
+#endif
+
+#if PA1_TRACE_LEVEL >= 1
+#define PA1_TRACE_INFO(category, ...) PA1_TRACE_AT(1, category, __VA_ARGS__)
+#else
+#define PA1_TRACE_INFO(category, ...) ((void) 0)
+#endif
+
+#if PA1_TRACE_LEVEL >= 2
+#define PA1_TRACE_DEBUG(category, ...) PA1_TRACE_AT(2, category, __VA_ARGS__)
+#else
+#define PA1_TRACE_DEBUG(category, ...) ((void) 0)
+#endif
+
+#endif
@@ -0,0 +1,1912 @@
+#include <iostream>
+#include <fstream>
+#include <sstream>
+#include <vector>
+#include <cstring>
+#include <string>
+#include <cctype>
+#include <climits>
+#include <cmath>
+#include <algorithm>
+#include <atomic>
+#include <functional>
+#include <memory>
+#include <thread>
+#include <charconv>
+#include <cstdint>
+#include <unordered_map>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#include "tree.h"
+#include "ctopo.h"
+#include "instrument.h"
+#include "trace.h"
+using namespace std;
+
+// Reads the first line of a parameter file into values[0..count-1].
+static int readParamLine(const std::string& filename, double* values, int count) {
+    std::ifstream fin(filename); // object for a file
+    if (!fin) { // NULL if unable to open file
+        cout << "Unable to open file" << endl;
+        return 0;
+    }
+
+    std::string line;
+
+    std::getline(fin, line);
+    if (line.empty())  {
+        return 0;
+    }
+
+    std::stringstream ss(line);
+    for (int i = 0; i < count; i++) {
+        ss >> values[i];
+    }
+
+    fin.close();
+    return 1;
+}
+
+int storeWireParams(const std::string& filename, Context& ctx) {
+    double v[2];
+    if (!readParamLine(filename, v, 2)) {
+        return 0;
+    }
+    ctx.unit_wire_res = v[0];
+    ctx.unit_wire_cap = v[1];
+    return 1;
+} 
+
+int storeInvParams(const std::string& filename, Context& ctx) {
+    double v[3];
+    if (!readParamLine(filename, v, 3)) {
+        return 0;
+    }
+    ctx.inv_input_cap = v[0];
+    ctx.inv_output_cap = v[1];
+    ctx.inv_output_res = v[2];
+    return 1;
+}
+
+// one corner per file, filling corners[k] from filenames[k]
+int storeWireParams(const std::vector<std::string>& filenames, std::vector<Context>& corners) {
+    corners.resize(filenames.size());
+    for (size_t k = 0; k < filenames.size(); k++) {
+        if (!storeWireParams(filenames[k], corners[k])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int storeInvParams(const std::vector<std::string>& filenames, std::vector<Context>& corners) {
+    corners.resize(filenames.size());
+    for (size_t k = 0; k < filenames.size(); k++) {
+        if (!storeInvParams(filenames[k], corners[k])) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+static const char* skipBlanks(const char* p, const char* end) {
+    while (p < end && (*p == ' ' || *p == '\t')) p++;
+    return p;
+}
+
+// Parses one leaf line, label(cap). Returns 0 if the line does not match.
+static int parseLeafLine(const char* p, const char* end, int& lbl, double& cap) {
+    auto r = std::from_chars(p, end, lbl);
+    if (r.ec != std::errc()) return 0;
+    p = skipBlanks(r.ptr, end);
+    if (p == end || *p != '(') return 0;
+    p = skipBlanks(p + 1, end);
+    auto c = std::from_chars(p, end, cap);
+    if (c.ec != std::errc()) return 0;
+    p = skipBlanks(c.ptr, end);
+    if (p == end || *p != ')') return 0;
+    return skipBlanks(p + 1, end) == end;
+}
+
+// Parses one non-leaf line, (leftWire rightWire). Returns 0 if the line does not match.
+static int parseBridgeLine(const char* p, const char* end, double& lw, double& rw) {
+    p = skipBlanks(p + 1, end);   // past '('
+    auto l = std::from_chars(p, end, lw);
+    if (l.ec != std::errc() || l.ptr == end || (*l.ptr != ' ' && *l.ptr != '\t')) return 0;
+    p = skipBlanks(l.ptr, end);
+    auto r = std::from_chars(p, end, rw);
+    if (r.ec != std::errc()) return 0;
+    p = skipBlanks(r.ptr, end);
+    if (p == end || *p != ')') return 0;
+    return skipBlanks(p + 1, end) == end;
+}
+
+// Walks the post-order text in [begin, end) line by line, in place, calling
+// on_leaf(label, cap) and on_bridge(leftWire, rightWire) for every record.
+// on_bridge returns 0 if there are not two subtrees for it to join. line_no
+// is carried over between calls so input can be scanned in pieces. Errors
+// are printed unless report is false.
+template <class OnLeaf, class OnBridge>
+int scanTopology(const char* begin, const char* end, size_t& line_no, OnLeaf on_leaf, OnBridge on_bridge,
+                 bool report = true) {
+    for (const char* line = begin; line < end; ) {
+        const char* eol = (const char*) memchr(line, '\n', end - line);
+        if (!eol) eol = end;
+        const char* next = eol + 1;
+        line_no++;
+
+        const char* last = eol;
+        while (last > line && (last[-1] == '\r' || last[-1] == ' ' || last[-1] == '\t')) last--;
+        const char* p = skipBlanks(line, last);
+        line = next;
+        if (p == last) continue;
+
+        // Leaf node format: d(%.10le)
+        if (std::isdigit((unsigned char) *p)) {
+            int lbl;
+            double cap;
+            if (!parseLeafLine(p, last, lbl, cap)) {
+                if (report) cout << "Malformed leaf on line " << line_no << endl;
+                return 0;
+            }
+            on_leaf(lbl, cap);
+        }
+        // non-leaf node format: (%.10le %.10le)
+        else if (*p == '(') {
+            double lw, rw;
+            if (!parseBridgeLine(p, last, lw, rw)) {
+                if (report) cout << "Malformed non-leaf on line " << line_no << endl;
+                return 0;
+            }
+            if (!on_bridge(lw, rw)) {
+                if (report) cout << "Non-leaf on line " << line_no << " has fewer than two subtrees below it" << endl;
+                return 0;
+            }
+        }
+        else {
+            if (report) cout << "Malformed line " << line_no << endl;
+            return 0;
+        }
+    }
+    return 1;
+}
+
+// checks what is left on the subtree stack once the whole input was read
+static int checkRoots(size_t roots) {
+    if (roots == 0) {
+        cout << "No tree found in file." << endl;
+        return 0;
+    }
+    if (roots > 1) {
+        cout << "Input has " << roots << " subtrees that are never joined" << endl;
+        return 0;
+    }
+    return 1;
+}
+
+// Builds the tree from the records scan(on_leaf, on_bridge) hands over in
+// post-order. Since children always come before their parent, total and
+// downstream (elmore) capacitance of every node are complete when this
+// returns.
+template <class Scan>
+static int buildTree(const Context& ctx, Tree& tree, Scan scan) {
+    std::vector<int> st; // indices of subtrees waiting for their parent
+    st.reserve(64);
+
+    auto on_leaf = [&](int lbl, double cap) {
+        int leaf = tree.addLeaf(lbl, cap);
+
+        tree.total_capacitance[leaf] += cap;
+
+        st.push_back(leaf);
+    };
+
+    auto on_bridge = [&](double lw, double rw) {
+        if (st.size() < 2) {
+            return 0;
+        }
+        int right = st.back(); st.pop_back();
+        int left = st.back(); st.pop_back();
+        int parent = tree.addBridge(lw, rw, left, right);
+
+        // at this point we know wire connecting parent to child
+        double l_wire_cap = ctx.unit_wire_cap * lw / (double) 2;
+        double r_wire_cap = ctx.unit_wire_cap * rw / (double) 2;
+
+        tree.total_capacitance[left] += l_wire_cap; // calculate Ce/2 of left wire
+        tree.total_capacitance[right] += r_wire_cap; // calculate Ce/2 of right wire
+
+        // both children are complete now, so their downstream capacitance is
+        // known: elmore_capacitance held the sum over their children until here
+        tree.elmore_capacitance[left] += tree.total_capacitance[left];
+        tree.elmore_capacitance[right] += tree.total_capacitance[right];
+
+        tree.total_capacitance[parent] += l_wire_cap + r_wire_cap;//Ce/2 of left wire and right
+        tree.elmore_capacitance[parent] = tree.elmore_capacitance[left] + tree.elmore_capacitance[right];
+
+        st.push_back(parent);
+        return 1;
+    };
+
+    if (!scan(on_leaf, on_bridge) || !checkRoots(st.size())) {
+        return 0;
+    }
+
+    tree.root = st.back();
+    tree.parsed = tree.size();
+    tree.total_capacitance[tree.root] += ctx.inv_output_cap;
+    // root is missing capacitance going into it Ce
+    tree.elmore_capacitance[tree.root] += tree.total_capacitance[tree.root];
+    return 1;
+}
+
+// A subtree waiting for its parent: a sink, or a non-leaf whose children
+// are nodes already. It only becomes a node once the wire above it is read,
+// because the capacitances of a node include half of that wire.
+struct PendingSubtree {
+    double a, b;        // sink cap and 0, or the two wire lengths
+    int left, right;    // -1 for a sink
+};
+
+// what makes two subtrees the same node
+struct SubtreeKey {
+    PendingSubtree s;
+    double wire;
+
+    bool operator==(const SubtreeKey& o) const {
+        return s.a == o.s.a && s.b == o.s.b && wire == o.wire && s.left == o.s.left && s.right == o.s.right;
+    }
+};
+
+struct SubtreeKeyHash {
+    size_t operator()(const SubtreeKey& k) const {
+        uint64_t h = 0;
+        for (double v : {k.s.a, k.s.b, k.wire}) {
+            uint64_t bits;
+            memcpy(&bits, &v, sizeof(bits));
+            h = (h ^ bits) * 0x100000001b3ULL;
+        }
+        h ^= ((uint64_t) (uint32_t) k.s.left << 32) | (uint32_t) k.s.right;
+        return h ^ (h >> 29);
+    }
+};
+
+// Same as buildTree, but a subtree that already occurred under the same
+// wire length is not added again: its parent links to the first copy. The
+// capacitances are summed in the same order, so they come out the same as
+// in the full tree.
+template <class Scan>
+static int buildShared(const Context& ctx, Tree& tree, Scan scan) {
+    std::unordered_map<SubtreeKey, int, SubtreeKeyHash> nodes;
+    std::vector<PendingSubtree> st;
+    st.reserve(64);
+
+    auto makeNode = [&](const PendingSubtree& s) {
+        if (s.left < 0) {
+            int leaf = tree.addLeaf(-1, s.a);
+            tree.total_capacitance[leaf] += s.a;
+            return leaf;
+        }
+        int node = tree.addBridge(s.a, s.b, s.left, s.right);
+        tree.total_capacitance[node] += (ctx.unit_wire_cap * s.a / (double) 2) + (ctx.unit_wire_cap * s.b / (double) 2);
+        tree.elmore_capacitance[node] = tree.elmore_capacitance[s.left] + tree.elmore_capacitance[s.right];
+        return node;
+    };
+
+    // the node for s below a wire of that length
+    auto intern = [&](const PendingSubtree& s, double wire) {
+        SubtreeKey key = {s, wire};
+        auto found = nodes.find(key);
+        if (found != nodes.end()) {
+            return found->second;
+        }
+        int node = makeNode(s);
+        tree.total_capacitance[node] += ctx.unit_wire_cap * wire / (double) 2;
+        tree.elmore_capacitance[node] += tree.total_capacitance[node];
+        nodes.emplace(key, node);
+        return node;
+    };
+
+    auto on_leaf = [&](int lbl, double cap) {
+        tree.sink_labels.push_back(lbl);
+        st.push_back({cap, 0, -1, -1});
+    };
+
+    auto on_bridge = [&](double lw, double rw) {
+        if (st.size() < 2) {
+            return 0;
+        }
+        PendingSubtree right = st.back(); st.pop_back();
+        PendingSubtree left = st.back(); st.pop_back();
+        int l = intern(left, lw);
+        int r = intern(right, rw);
+        st.push_back({lw, rw, l, r});
+        return 1;
+    };
+
+    if (!scan(on_leaf, on_bridge) || !checkRoots(st.size())) {
+        return 0;
+    }
+
+    // nothing else is the whole tree, so the root is never shared
+    tree.root = makeNode(st.back());
+    tree.parsed = tree.size();
+    tree.total_capacitance[tree.root] += ctx.inv_output_cap;
+    tree.elmore_capacitance[tree.root] += tree.total_capacitance[tree.root];
+    return 1;
+}
+
+// ---- parallel text parse ----
+
+// below this the text is parsed on one thread
+static const size_t parallel_parse_min = 4 << 20;
+
+// a decoded line: a sink (label >= 0, a = cap) or a non-leaf (label -1, a
+// and b the two wires)
+struct TextRecord {
+    double a, b;
+    int label;
+};
+
+// One piece of the text, cut right after a newline, and its records. A piece
+// with a malformed line keeps the records before it and ok = false.
+struct TextChunk {
+    const char* begin;
+    const char* end;
+    std::vector<TextRecord> records;
+    size_t lines = 0;
+    bool ok = true;
+};
+
+// phase one, on any thread; errors are only reported by phase two
+static void decodeChunk(TextChunk& c) {
+    size_t newlines = 0;
+    for (const char* p = c.begin; (p = (const char*) memchr(p, '\n', c.end - p)); p++) {
+        newlines++;
+    }
+    c.records.reserve(newlines + 1);
+    auto on_leaf = [&](int lbl, double cap) {
+        c.records.push_back({cap, 0, lbl});
+    };
+    auto on_bridge = [&](double lw, double rw) {
+        c.records.push_back({lw, rw, -1});
+        return 1;
+    };
+    c.ok = scanTopology(c.begin, c.end, c.lines, on_leaf, on_bridge, false);
+}
+
+// The text is cut into a few pieces per thread at line boundaries and every
+// piece is decoded into records on the pool. Linking them up is the only
+// part that needs the post-order stack; buildTree (or buildShared) does that
+// on this thread from the records, in file order. Errors come out as from
+// the sequential parse: a piece is scanned again to find the line number.
+static int parseTopologyParallel(const Context& ctx, const char* begin, const char* end, Tree& tree, TaskPool& pool) {
+    size_t pieces = pool.size() * 4;
+    size_t step = (end - begin) / pieces + 1;
+    std::vector<TextChunk> chunks;
+    for (const char* p = begin; p < end; ) {
+        const char* cut = p + std::min(step, (size_t) (end - p));
+        if (cut < end) {
+            const char* eol = (const char*) memchr(cut, '\n', end - cut);
+            cut = eol ? eol + 1 : end;
+        }
+        TextChunk c;
+        c.begin = p;
+        c.end = cut;
+        chunks.push_back(std::move(c));
+        p = cut;
+    }
+    for (TextChunk& c : chunks) {
+        pool.spawn([&c] { decodeChunk(c); });
+    }
+    pool.wait();
+
+    auto scan = [&](auto on_leaf, auto on_bridge) {
+        size_t first_line = 0;
+        for (const TextChunk& c : chunks) {
+            for (size_t i = 0; i < c.records.size(); i++) {
+                const TextRecord& r = c.records[i];
+                if (r.label >= 0) {
+                    on_leaf(r.label, r.a);
+                } else if (!on_bridge(r.a, r.b)) {
+                    // the line of record i
+                    size_t line_no = first_line, seen = 0, bad = 0;
+                    auto count = [&](auto...) {
+                        if (seen++ == i) bad = line_no;
+                        return 1;
+                    };
+                    scanTopology(c.begin, c.end, line_no, count, count, false);
+                    cout << "Non-leaf on line " << bad << " has fewer than two subtrees below it" << endl;
+                    return 0;
+                }
+            }
+            if (!c.ok) {
+                // prints the malformed line
+                size_t line_no = first_line;
+                scanTopology(c.begin, c.end, line_no, [](int, double) {}, [](double, double) { return 1; });
+                return 0;
+            }
+            first_line += c.lines;
+        }
+        return 1;
+    };
+    if (ctx.share_subtrees) {
+        return buildShared(ctx, tree, scan);
+    }
+    size_t records = 0;
+    for (const TextChunk& c : chunks) {
+        records += c.records.size();
+    }
+    tree.reserve(records);
+    return buildTree(ctx, tree, scan);
+}
+
+// Builds the tree from the post-order text in [begin, end). Every line is
+// scanned in place and numbers are read with from_chars, nothing is copied.
+// Large inputs are decoded on the pool when there is one.
+int parseTopology(const Context& ctx, const char* begin, const char* end, Tree& tree, TaskPool* pool) {
+    if (pool && pool->size() > 1 && (size_t) (end - begin) >= parallel_parse_min) {
+        return parseTopologyParallel(ctx, begin, end, tree, *pool);
+    }
+    auto scan = [&](auto on_leaf, auto on_bridge) {
+        size_t line_no = 0;
+        return scanTopology(begin, end, line_no, on_leaf, on_bridge);
+    };
+    if (ctx.share_subtrees) {
+        return buildShared(ctx, tree, scan);
+    }
+
+    // one node per line at most, so the arrays never have to grow while parsing
+    size_t lines = 1;
+    for (const char* p = begin; (p = (const char*) memchr(p, '\n', end - p)); p++) {
+        lines++;
+    }
+    tree.reserve(lines);
+    return buildTree(ctx, tree, scan);
+}
+
+// ---- binary topology (.btopo) ----
+
+static const char btopo_magic[8] = {'B', 'T', 'O', 'P', 'O', '1', 0, 0};
+static const size_t leaf_record = sizeof(int) + sizeof(double);
+static const size_t wire_record = 2 * sizeof(int) + 2 * sizeof(double);
+
+// Walks the records in [begin, end), the layout of out4: a sink is its
+// label and cap, anything else is -1, two wire lengths and an inverter
+// count. A record with a right wire below zero is an inverter over the
+// subtree before it (out4 of an earlier run); it is taken out again and
+// its wire added to the one above, so the net comes back unbuffered.
+template <class OnLeaf, class OnBridge>
+static int scanBinaryTopology(const char* begin, const char* end, OnLeaf on_leaf, OnBridge on_bridge) {
+    std::vector<double> extra;    // wire of inverters taken out above each pending subtree
+    size_t record_no = 0;
+    for (const char* p = begin; p < end; ) {
+        record_no++;
+        int tag;
+        if ((size_t) (end - p) < leaf_record) {
+            cout << "Truncated record " << record_no << endl;
+            return 0;
+        }
+        memcpy(&tag, p, sizeof(int));
+        if (tag != -1) {
+            double cap;
+            memcpy(&cap, p + sizeof(int), sizeof(double));
+            p += leaf_record;
+            on_leaf(tag, cap);
+            extra.push_back(0);
+            continue;
+        }
+
+        if ((size_t) (end - p) < wire_record) {
+            cout << "Truncated record " << record_no << endl;
+            return 0;
+        }
+        double lw, rw;
+        memcpy(&lw, p + sizeof(int), sizeof(double));
+        memcpy(&rw, p + sizeof(int) + sizeof(double), sizeof(double));
+        p += wire_record;
+
+        if (rw < 0) {
+            if (extra.empty()) {
+                cout << "Inverter in record " << record_no << " has no subtree below it" << endl;
+                return 0;
+            }
+            extra.back() += lw;
+            continue;
+        }
+        if (extra.size() < 2) {
+            cout << "Non-leaf in record " << record_no << " has fewer than two subtrees below it" << endl;
+            return 0;
+        }
+        lw += extra[extra.size() - 2];
+        rw += extra[extra.size() - 1];
+        extra.pop_back();
+        extra.back() = 0;
+        if (!on_bridge(lw, rw)) {
+            return 0;
+        }
+    }
+    return 1;
+}
+
+int parseBinaryTopology(const Context& ctx, const char* begin, const char* end, Tree& tree) {
+    size_t nodes = 0;
+    if ((size_t) (end - begin) >= sizeof(BtopoHeader) && memcmp(begin, btopo_magic, sizeof(btopo_magic)) == 0) {
+        BtopoHeader header;
+        memcpy(&header, begin, sizeof(header));
+        begin += sizeof(header);
+        size_t expect = header.sinks * leaf_record + (header.bridges + header.inverters) * wire_record;
+        if ((size_t) (end - begin) != expect) {
+            cout << "Binary topology does not have the records its header lists" << endl;
+            return 0;
+        }
+        nodes = header.sinks + header.bridges;
+    } else {
+        // no header: count the sinks and non-leaves first
+        for (const char* p = begin; p + sizeof(int) <= end; ) {
+            int tag;
+            memcpy(&tag, p, sizeof(int));
+            if (tag != -1) {
+                nodes++;
+                p += leaf_record;
+            } else {
+                double rw = 0;
+                if (p + wire_record <= end) {
+                    memcpy(&rw, p + sizeof(int) + sizeof(double), sizeof(double));
+                }
+                nodes += rw >= 0;
+                p += wire_record;
+            }
+        }
+    }
+
+    auto scan = [&](auto on_leaf, auto on_bridge) {
+        return scanBinaryTopology(begin, end, on_leaf, on_bridge);
+    };
+    if (ctx.share_subtrees) {
+        return buildShared(ctx, tree, scan);
+    }
+    tree.reserve(nodes);
+    return buildTree(ctx, tree, scan);
+}
+
+// ---- compact topology (.ctopo, see ctopo.h) ----
+
+// reads one value written by CtopoEncoder::putValue
+static int getValue(const char*& p, const char* end, int& exponent, double& v) {
+    uint64_t de, m;
+    if (!getVarint(p, end, de) || !getVarint(p, end, m)) {
+        return 0;
+    }
+    exponent += (int) unzigzag(de);
+    v = decodeDecimal(unzigzag(m), exponent);
+    return 1;
+}
+
+// Decodes the blocks after the header one by one, straight into the
+// callbacks. Inverter records are taken out the way scanBinaryTopology
+// does it. records is the count the header lists, so a file cut at a block
+// boundary is caught too.
+template <class OnLeaf, class OnBridge>
+static int scanCompactTopology(const char* begin, const char* end, uint64_t records, OnLeaf on_leaf,
+                                  OnBridge on_bridge) {
+    std::vector<double> extra;    // wire of inverters taken out above each pending subtree
+    size_t record_no = 0;
+    size_t block_no = 0;
+    for (const char* p = begin; p < end; ) {
+        block_no++;
+        uint32_t head[2];
+        if ((size_t) (end - p) < sizeof(head)) {
+            cout << "Truncated block " << block_no << endl;
+            return 0;
+        }
+        memcpy(head, p, sizeof(head));
+        p += sizeof(head);
+        if ((size_t) (end - p) < head[1]) {
+            cout << "Truncated block " << block_no << endl;
+            return 0;
+        }
+        const char* block_end = p + head[1];
+        CtopoRegisters reg;
+        for (uint32_t k = 0; k < head[0]; k++) {
+            record_no++;
+            if (p >= block_end) {
+                cout << "Truncated record " << record_no << endl;
+                return 0;
+            }
+            int tag = (uint8_t) *p++;
+            int kind = tag & 3;
+            int ok = 1;
+
+            if (kind == CTOPO_SINK) {
+                if (!(tag & ctopo_next_label)) {
+                    uint64_t d;
+                    ok = getVarint(p, block_end, d);
+                    reg.label += (int) unzigzag(d);
+                } else {
+                    reg.label++;
+                }
+                if (ok && !(tag & ctopo_same_first)) {
+                    ok = getValue(p, block_end, reg.cap_exponent, reg.cap);
+                }
+                if (!ok) {
+                    cout << "Truncated record " << record_no << endl;
+                    return 0;
+                }
+                on_leaf(reg.label, reg.cap);
+                extra.push_back(0);
+                continue;
+            }
+            if (kind != CTOPO_BRIDGE && kind != CTOPO_INVERTER) {
+                cout << "Unknown record kind in record " << record_no << endl;
+                return 0;
+            }
+
+            if (!(tag & ctopo_same_first)) {
+                ok = getValue(p, block_end, reg.wire_exponent, reg.wire);
+            }
+            double lw = reg.wire;
+            if (ok && kind == CTOPO_BRIDGE && !(tag & ctopo_same_second)) {
+                ok = getValue(p, block_end, reg.wire_exponent, reg.wire);
+            }
+            double rw = reg.wire;
+            if (!ok) {
+                cout << "Truncated record " << record_no << endl;
+                return 0;
+            }
+
+            if (kind == CTOPO_INVERTER) {
+                if (extra.empty()) {
+                    cout << "Inverter in record " << record_no << " has no subtree below it" << endl;
+                    return 0;
+                }
+                extra.back() += lw;
+                continue;
+            }
+            if (extra.size() < 2) {
+                cout << "Non-leaf in record " << record_no << " has fewer than two subtrees below it" << endl;
+                return 0;
+            }
+            lw += extra[extra.size() - 2];
+            rw += extra[extra.size() - 1];
+            extra.pop_back();
+            extra.back() = 0;
+            if (!on_bridge(lw, rw)) {
+                return 0;
+            }
+        }
+        if (p != block_end) {
+            cout << "Block " << block_no << " is longer than its records" << endl;
+            return 0;
+        }
+    }
+    if (record_no != records) {
+        cout << "Compact topology does not have the records its header lists" << endl;
+        return 0;
+    }
+    return 1;
+}
+
+int parseCompactTopology(const Context& ctx, const char* begin, const char* end, Tree& tree) {
+    CtopoHeader header;
+    if ((size_t) (end - begin) < sizeof(header) || memcmp(begin, ctopo_magic, sizeof(ctopo_magic)) != 0) {
+        cout << "Not a compact topology" << endl;
+        return 0;
+    }
+    memcpy(&header, begin, sizeof(header));
+    begin += sizeof(header);
+
+    auto scan = [&](auto on_leaf, auto on_bridge) {
+        return scanCompactTopology(begin, end, header.sinks + header.bridges + header.inverters, on_leaf,
+                                      on_bridge);
+    };
+    if (ctx.share_subtrees) {
+        return buildShared(ctx, tree, scan);
+    }
+    tree.reserve(header.sinks + header.bridges);
+    return buildTree(ctx, tree, scan);
+}
+
+// read-only mapping of a whole input file
+struct MappedFile {
+    const char* data = nullptr;
+    size_t size = 0;
+
+    // returns 0 if the file cannot be opened, 1 otherwise (size may be 0)
+    int open(const std::string& filename) {
+        int fd = ::open(filename.c_str(), O_RDONLY);
+        if (fd < 0) {
+            return 0;
+        }
+        struct stat st;
+        if (fstat(fd, &st) != 0) {
+            ::close(fd);
+            return 0;
+        }
+        size = st.st_size;
+        if (size > 0) {
+            void* p = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if (p == MAP_FAILED) {
+                ::close(fd);
+                size = 0;
+                return 0;
+            }
+            data = static_cast<const char*>(p);
+            madvise(p, size, MADV_SEQUENTIAL);
+        }
+        ::close(fd);
+        return 1;
+    }
+
+    ~MappedFile() {
+        if (data) {
+            munmap(const_cast<char*>(data), size);
+        }
+    }
+};
+
+// a .btopo name or the header of the extended variant
+static int isBinaryTopology(const std::string& filename, const char* data, size_t size) {
+    const std::string ext = ".btopo";
+    if (filename.size() >= ext.size() && filename.compare(filename.size() - ext.size(), ext.size(), ext) == 0) {
+        return 1;
+    }
+    return size >= sizeof(btopo_magic) && memcmp(data, btopo_magic, sizeof(btopo_magic)) == 0;
+}
+
+int isBinaryTopology(const std::string& filename) {
+    MappedFile file;
+    return file.open(filename) && isBinaryTopology(filename, file.data, file.size);
+}
+
+// a .ctopo name or its header
+static int isCompactTopology(const std::string& filename, const char* data, size_t size) {
+    const std::string ext = ".ctopo";
+    if (filename.size() >= ext.size() && filename.compare(filename.size() - ext.size(), ext.size(), ext) == 0) {
+        return 1;
+    }
+    return size >= sizeof(ctopo_magic) && memcmp(data, ctopo_magic, sizeof(ctopo_magic)) == 0;
+}
+
+int isCompactTopology(const std::string& filename) {
+    MappedFile file;
+    return file.open(filename) && isCompactTopology(filename, file.data, file.size);
+}
+
+int parseTree(const Context& ctx, const std::string& filename, Tree& tree, TaskPool* pool) {
+    PA1_PHASE("parse");
+    MappedFile file;
+    if (!file.open(filename)) {
+        cout << "Unable to open file" << endl;
+        return 0;
+    }
+    if (file.size == 0) {
+        cout << "No tree found in file." << endl;
+        return 0;
+    }
+
+    int ok;
+    if (isCompactTopology(filename, file.data, file.size)) {
+        ok = parseCompactTopology(ctx, file.data, file.data + file.size, tree);
+    } else if (isBinaryTopology(filename, file.data, file.size)) {
+        ok = parseBinaryTopology(ctx, file.data, file.data + file.size, tree);
+    } else {
+        ok = parseTopology(ctx, file.data, file.data + file.size, tree, pool);
+    }
+    PA1_COUNT(COUNT_NODES_PARSED, ok ? tree.parsed : 0);
+    if (ok) {
+        PA1_TRACE_INFO(TRACE_PARSE, "%s: %d nodes, %zu shared sinks", filename.c_str(), tree.parsed,
+                       tree.sink_labels.size());
+    }
+    return ok;
+}
+
+// out2/out4 records, packed the way the separate fwrites used to lay them out
+static void putLeafRecord(BufferedWriter& out, int label, double value) {
+    char rec[sizeof(int) + sizeof(double)];
+    memcpy(rec, &label, sizeof(int));
+    memcpy(rec + sizeof(int), &value, sizeof(double));
+    out.put(rec, sizeof(rec));
+}
+
+static void putWireRecord(BufferedWriter& out, double left_wire, double right_wire, int inverter) {
+    int none = -1;
+    char rec[2 * sizeof(int) + 2 * sizeof(double)];
+    memcpy(rec, &none, sizeof(int));
+    memcpy(rec + sizeof(int), &left_wire, sizeof(double));
+    memcpy(rec + sizeof(int) + sizeof(double), &right_wire, sizeof(double));
+    memcpy(rec + sizeof(int) + 2 * sizeof(double), &inverter, sizeof(int));
+    out.put(rec, sizeof(rec));
+}
+
+// label(cap)
+static void printLeafLine(BufferedWriter& out, int label, double cap) {
+    out.print(label);
+    out.print('(');
+    out.printSci(cap);
+    out.print(")\n");
+}
+
+// (left right) or (left right inverter)
+static void printWireLine(BufferedWriter& out, double left_wire, double right_wire, const char* inverter) {
+    out.print('(');
+    out.printSci(left_wire);
+    out.print(' ');
+    out.printSci(right_wire);
+    out.print(inverter);
+    out.print(")\n");
+}
+
+// label of the sink-th sink from the left when node is that sink
+static int sinkLabel(const Tree& tree, int node, int sink) {
+    return tree.shared() ? tree.sink_labels[sink] : tree.label[node];
+}
+
+void preOrderTraversal(const Tree& tree, BufferedWriter& fout, const double* left_wire, const double* right_wire) {
+    std::vector<int> st;
+    st.push_back(tree.root);
+    int sink = 0;
+
+    while (!st.empty()) {
+        int node = st.back(); st.pop_back();
+
+        if (tree.type[node]==LEAF) {
+            printLeafLine(fout, sinkLabel(tree, node, sink++), tree.capacitance[node]);
+        } else if (tree.type[node]==BRIDGE){
+            if (left_wire) {
+                printWireLine(fout, left_wire[node], right_wire[node], "");
+            } else {
+                printWireLine(fout, tree.leftWire[node], tree.rightWire[node], "");
+            }
+        }
+
+        // right goes first so that left comes off the stack first
+        if (tree.right[node] >= 0) st.push_back(tree.right[node]);
+        if (tree.left[node] >= 0) st.push_back(tree.left[node]);
+    }
+
+}
+
+int writePre(const Context& ctx, const Tree& tree, const std::string& filename) {
+    PA1_PHASE("out1");
+    BufferedWriter fout;
+    if (!fout.open(filename, ctx.io)) {
+        cout << "Unable to open file.\n";
+        return 0;
+    }
+
+    preOrderTraversal(tree, fout);
+
+    return fout.close();
+}
+
+struct TaskTree;
+
+// subtrees smaller than this are not worth a task of their own
+static const int task_cutoff = 1 << 14;
+
+// One piece of the parallel passes: either a whole subtree [lo, node] done
+// in one go, or (join) just node itself, after the tasks for its two
+// subtrees. Pieces are numbered in post-order of the subtrees they cover.
+struct SubtreeTask {
+    int lo, node;
+    bool join;
+    int parent;       // -1 for the task covering the root
+    int kids[2] = {-1, -1};   // the two tasks below a join
+    std::atomic<int> waiting{0};
+    std::unique_ptr<TaskTree> work;
+    int base = 0;     // where its inverters go in the merged tree
+    double btc = 0;   // branchTimeConstraint of node once the task is done
+};
+
+// Splits the tree into tasks: a node is a join if both of its subtrees are
+// at least task_cutoff nodes, otherwise its subtree is one task. Chains have
+// a small side at every level and stay in one task. The result is in the
+// post-order of the subtrees, which is also the order of the node indices.
+static std::vector<std::unique_ptr<SubtreeTask>> splitTree(const Tree& tree) {
+    std::vector<std::unique_ptr<SubtreeTask>> tasks;
+    // (lo, node, parent task, children already split)
+    struct Range { int lo, node, parent; bool expanded; };
+    std::vector<Range> st;
+    st.push_back({0, tree.root, -1, false});
+    std::vector<int> ids;   // task id of every expanded join on the stack
+
+    while (!st.empty()) {
+        Range r = st.back();
+        int node = r.node;
+        bool split = false;
+        if (tree.type[node] == BRIDGE) {
+            int l = tree.left[node];
+            split = (l - r.lo + 1 >= task_cutoff) && (node - 1 - l >= task_cutoff);
+        }
+
+        if (split && !r.expanded) {
+            // reserve the join's place after both children, fill in parent later
+            st.back().expanded = true;
+            int l = tree.left[node];
+            st.push_back({l + 1, node - 1, -2, false});
+            st.push_back({r.lo, l, -2, false});
+            continue;
+        }
+        st.pop_back();
+
+        auto task = std::make_unique<SubtreeTask>();
+        task->lo = r.lo;
+        task->node = node;
+        task->join = split;
+        task->parent = -1;
+        int id = (int) tasks.size();
+        if (split) {
+            // both children were finished right before this one
+            int right_id = ids.back(); ids.pop_back();
+            int left_id = ids.back(); ids.pop_back();
+            tasks[left_id]->parent = id;
+            tasks[right_id]->parent = id;
+            task->kids[0] = left_id;
+            task->kids[1] = right_id;
+            task->waiting = 2;
+        }
+        tasks.push_back(std::move(task));
+        ids.push_back(id);
+    }
+    return tasks;
+}
+
+// delays below node for the subtree [lo, node], whose own delay is already set
+static void delayRange(const Context& ctx, Tree& tree, int lo, int node) {
+    // a backward scan sees every parent before its children
+    for (int i = node; i >= lo; i--) {
+        if (tree.type[i] != BRIDGE) {
+            continue;
+        }
+        int l = tree.left[i];
+        int r = tree.right[i];
+        double curr_elmore_delay = tree.elmore_delay[i];
+        tree.elmore_delay[l] = curr_elmore_delay + (ctx.unit_wire_res * tree.leftWire[i] * tree.elmore_capacitance[l]);
+        tree.elmore_delay[r] = curr_elmore_delay + (ctx.unit_wire_res * tree.rightWire[i] * tree.elmore_capacitance[r]);
+    }
+}
+
+// A node of a shared tree has a delay for each place it occurs at, so they
+// are carried down a walk of the expanded tree instead of being stored.
+static void delayShared(const Context& ctx, const Tree& tree, DelayWriter& fp) {
+    std::vector<std::pair<int, double>> st;
+    st.push_back({tree.root, tree.elmore_delay[tree.root]});
+    int sink = 0;
+
+    while (!st.empty()) {
+        int node = st.back().first;
+        double curr_elmore_delay = st.back().second;
+        st.pop_back();
+
+        if (tree.type[node] == LEAF) {
+            fp.put(tree.sink_labels[sink++], curr_elmore_delay);
+            continue;
+        }
+        int l = tree.left[node];
+        int r = tree.right[node];
+        st.push_back({r, curr_elmore_delay + (ctx.unit_wire_res * tree.rightWire[node] * tree.elmore_capacitance[r])});
+        st.push_back({l, curr_elmore_delay + (ctx.unit_wire_res * tree.leftWire[node] * tree.elmore_capacitance[l])});
+    }
+}
+
+void delayPreOrder(const Context& ctx, Tree& tree, DelayWriter& fp, TaskPool* pool) {
+    int root = tree.root;
+    tree.elmore_delay[root] = 0 + (ctx.inv_output_res * tree.elmore_capacitance[root]);
+
+    if (tree.shared()) {
+        delayShared(ctx, tree, fp);
+        return;
+    }
+
+    if (pool && pool->size() > 1) {
+        // every node only depends on its parent, so once the join nodes are
+        // done (parents first, hence backwards) the other tasks can all run at once
+        std::vector<std::unique_ptr<SubtreeTask>> tasks = splitTree(tree);
+        for (int id = (int) tasks.size() - 1; id >= 0; id--) {
+            if (tasks[id]->join) {
+                delayRange(ctx, tree, tasks[id]->node, tasks[id]->node);
+            }
+        }
+        for (auto& t : tasks) {
+            if (!t->join) {
+                int lo = t->lo, node = t->node;
+                pool->spawn([&ctx, &tree, lo, node] { delayRange(ctx, tree, lo, node); });
+            }
+        }
+        pool->wait();
+    } else {
+        delayRange(ctx, tree, 0, root);
+    }
+
+    writeLeafDelays(tree, fp);
+}
+
+void writeLeafDelays(const Tree& tree, DelayWriter& fp) {
+    // leaves come in the same relative order in pre-order and post-order
+    for (int i = 0; i < tree.parsed; i++) {
+        if (tree.type[i]==LEAF) {
+            fp.put(tree.label[i], tree.elmore_delay[i]);
+        }
+    }
+}
+
+int writeDelays(const Context& ctx, const Tree& tree, const std::string& filename) {
+    DelayWriter fp;
+    if (!fp.open(filename, ctx.io, ctx.index_delays)) {
+        std::cout << "Error: cannot open file\n";
+        return 0;
+    }
+    writeLeafDelays(tree, fp);
+    return fp.close();
+}
+int elmoreDelay(const Context& ctx, Tree& tree, const std::string& filename, TaskPool* pool) {
+    DelayWriter fp;
+    if (!fp.open(filename, ctx.io, ctx.index_delays)) {
+        std::cout << "Error: cannot open file\n";
+        return 0;
+    }
+    elmoreDelay(ctx, tree, fp, pool);
+    return fp.close();
+}
+
+void elmoreDelay(const Context& ctx, Tree& tree, DelayWriter& fp, TaskPool* pool) {
+    PA1_PHASE("elmore");
+    // downstream capacitance was already accumulated bottom up by parseTree,
+    // only the top down (reverse post-order) scan for R*C = T is left
+    delayPreOrder(ctx, tree, fp, pool);
+    PA1_TRACE_INFO(TRACE_ELMORE, "delays of %d nodes, %d threads", tree.parsed, pool ? pool->size() : 1);
+}
+
+// Node record spilled by the streaming Elmore pass, one per node in post-order.
+// The wire above a node is only known once its parent is read, so a record
+// holds the capacitance without it and the parent adds it back later.
+struct SpillRecord {
+    int label;             // -1 for a non-leaf
+    double own_cap;        // total capacitance without the wire above
+    double child_cap;      // downstream capacitance of the children
+    double leftWire, rightWire;
+};
+
+// temporary file that is gone as soon as it is closed
+static int openSpillFile() {
+    const char* dir = getenv("TMPDIR");
+    std::string path = std::string(dir && *dir ? dir : "/tmp") + "/pa1-spill-XXXXXX";
+    int fd = mkstemp(&path[0]);
+    if (fd >= 0) {
+        unlink(path.c_str());
+    }
+    return fd;
+}
+
+// all n bytes at offset, retrying short transfers; false on an error or,
+// for reads, the end of the file
+static bool preadAll(int fd, void* buf, size_t n, off_t offset) {
+    char* p = static_cast<char*>(buf);
+    while (n > 0) {
+        ssize_t got = pread(fd, p, n, offset);
+        if (got <= 0) {
+            return false;
+        }
+        p += got;
+        n -= got;
+        offset += got;
+    }
+    return true;
+}
+
+static bool pwriteAll(int fd, const void* buf, size_t n, off_t offset) {
+    const char* p = static_cast<const char*>(buf);
+    while (n > 0) {
+        ssize_t put = pwrite(fd, p, n, offset);
+        if (put <= 0) {
+            return false;
+        }
+        p += put;
+        n -= put;
+        offset += put;
+    }
+    return true;
+}
+
+// Elmore delay without building the tree, for nets that do not fit in memory.
+// The bottom-up pass keeps only the stack of open subtrees (bounded by the
+// tree depth) and spills every node to a temporary file. The top-down pass
+// reads the spill backwards, which visits parents before children, with a
+// stack of pending wires. Leaves come out in reverse, so out2 is filled from
+// the end. Only out2 is produced. Values are bit-identical to elmoreDelay.
+int elmoreDelayStreaming(const Context& ctx, const std::string& topology, const std::string& filename) {
+    PA1_PHASE("elmore_stream");
+    MappedFile file;
+    if (!file.open(topology)) {
+        cout << "Unable to open file" << endl;
+        return 0;
+    }
+
+    int spill = openSpillFile();
+    if (spill < 0) {
+        cout << "Error: cannot create spill file\n";
+        return 0;
+    }
+    FILE* spill_fp = fdopen(spill, "w+b");
+    if (!spill_fp) {
+        ::close(spill);
+        cout << "Error: cannot create spill file\n";
+        return 0;
+    }
+    bool spill_failed = false;  // a full $TMPDIR shows up as a short fwrite
+
+    // bottom up: (own_cap, child_cap) of every subtree waiting for its parent
+    std::vector<std::pair<double, double>> st;
+    size_t nodes = 0;
+    size_t leaves = 0;
+
+    auto spillNode = [&](int lbl, double own, double child, double lw, double rw) {
+        SpillRecord rec;
+        memset(&rec, 0, sizeof(rec));
+        rec.label = lbl;
+        rec.own_cap = own;
+        rec.child_cap = child;
+        rec.leftWire = lw;
+        rec.rightWire = rw;
+        spill_failed |= fwrite(&rec, sizeof(rec), 1, spill_fp) != 1;
+        nodes++;
+    };
+
+    auto on_leaf = [&](int lbl, double cap) {
+        spillNode(lbl, cap, 0, 0, 0);
+        st.push_back({cap, 0.0});
+        leaves++;
+    };
+
+    auto on_bridge = [&](double lw, double rw) {
+        if (st.size() < 2) {
+            return 0;
+        }
+        std::pair<double, double> r = st.back(); st.pop_back();
+        std::pair<double, double> l = st.back(); st.pop_back();
+
+        double l_wire_cap = ctx.unit_wire_cap * lw / (double) 2;
+        double r_wire_cap = ctx.unit_wire_cap * rw / (double) 2;
+        double own = l_wire_cap + r_wire_cap;
+        double child = (l.second + (l.first + l_wire_cap)) + (r.second + (r.first + r_wire_cap));
+
+        spillNode(-1, own, child, lw, rw);
+        st.push_back({own, child});
+        return 1;
+    };
+
+    // scan in windows and drop the pages behind us, so the mapped input
+    // does not pile up in the resident set
+    const size_t window = 16 << 20;
+    size_t line_no = 0;
+    for (size_t pos = 0; pos < file.size; ) {
+        size_t stop = pos + window;
+        if (stop >= file.size) {
+            stop = file.size;
+        } else {
+            const char* nl = (const char*) memchr(file.data + stop, '\n', file.size - stop);
+            stop = nl ? (nl - file.data) + 1 : file.size;
+        }
+        if (!scanTopology(file.data + pos, file.data + stop, line_no, on_leaf, on_bridge)) {
+            fclose(spill_fp);
+            return 0;
+        }
+        size_t page = sysconf(_SC_PAGESIZE);
+        size_t done = stop / page * page;
+        size_t from = pos / page * page;
+        if (done > from) {
+            madvise(const_cast<char*>(file.data) + from, done - from, MADV_DONTNEED);
+        }
+        pos = stop;
+    }
+    if (!checkRoots(st.size())) {
+        fclose(spill_fp);
+        return 0;
+    }
+    if (spill_failed || fflush(spill_fp) != 0 || ferror(spill_fp)) {
+        cout << "Error: cannot write spill file\n";
+        fclose(spill_fp);
+        return 0;
+    }
+
+    int out = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (out < 0) {
+        std::cout << "Error: cannot open file\n";
+        fclose(spill_fp);
+        return 0;
+    }
+
+    // top down: (parent delay, wire resistance, wire Ce/2) of nodes still to come
+    struct Pending {
+        double delay, resistance, wire_cap;
+    };
+    std::vector<Pending> pending;
+    pending.push_back({0, ctx.inv_output_res, ctx.inv_output_cap});
+
+    const size_t block = 1 << 16;
+    const size_t record = sizeof(int) + sizeof(double);
+    std::vector<SpillRecord> recs(block);
+    std::vector<char> outbuf(block * record);
+    size_t filled = 0;          // records at the end of outbuf
+    size_t next_leaf = leaves;  // out2 slot after the last one still free
+
+    bool out_failed = false;
+    auto flushLeaves = [&]() {
+        next_leaf -= filled;
+        out_failed |= !pwriteAll(out, outbuf.data() + (block - filled) * record, filled * record, next_leaf * record);
+        filled = 0;
+    };
+
+    for (size_t left_over = nodes; left_over > 0 && !out_failed; ) {
+        size_t n = left_over < block ? left_over : block;
+        left_over -= n;
+        if (!preadAll(spill, recs.data(), n * sizeof(SpillRecord), left_over * sizeof(SpillRecord))) {
+            cout << "Error: cannot read spill file\n";
+            ::close(out);
+            fclose(spill_fp);
+            return 0;
+        }
+
+        for (size_t k = n; k-- > 0; ) {
+            const SpillRecord& rec = recs[k];
+            Pending up = pending.back(); pending.pop_back();
+
+            double elmore_cap = rec.child_cap + (rec.own_cap + up.wire_cap);
+            double delay = up.delay + (up.resistance * elmore_cap);
+
+            if (rec.label >= 0) {
+                filled++;
+                char* slot = outbuf.data() + (block - filled) * record;
+                memcpy(slot, &rec.label, sizeof(int));
+                memcpy(slot + sizeof(int), &delay, sizeof(double));
+                if (filled == block) {
+                    flushLeaves();
+                }
+            } else {
+                // the right subtree is just before its parent in post-order
+                pending.push_back({delay, ctx.unit_wire_res * rec.leftWire, ctx.unit_wire_cap * rec.leftWire / (double) 2});
+                pending.push_back({delay, ctx.unit_wire_res * rec.rightWire, ctx.unit_wire_cap * rec.rightWire / (double) 2});
+            }
+        }
+    }
+    flushLeaves();
+
+    out_failed |= ::close(out) != 0;
+    fclose(spill_fp);
+    if (out_failed) {
+        std::cout << "Error: cannot write file\n";
+        return 0;
+    }
+    return 1;
+}
+
+// Four corners side by side; GCC turns the arithmetic on these into one
+// vector instruction per operation where the target has one. Without AVX
+// in the base flags GCC only gives the type 16 byte alignment, while the
+// avx2 clone below uses aligned 32 byte loads, so ask for it explicitly.
+typedef double Lanes __attribute__((vector_size(4 * sizeof(double)), aligned(32)));
+static const int lane_count = 4;
+
+// per node, for the four lanes
+struct alignas(32) CornerNode {
+    Lanes total;
+    Lanes delay;   // the downstream capacitance until the delay is known
+};
+
+// Capacitance and delay of every parsed node for up to four corners at once.
+// Each lane does exactly the operations of the scalar passes in the same
+// order, so every corner gets the delays a run with only its parameters
+// would get. The avx2 clone is picked at load time where the CPU has it.
+__attribute__((target_clones("avx2", "default")))
+static void elmoreLanes(const Tree& tree, const Context* c, CornerNode* nodes) {
+    Lanes wire_res, wire_cap, out_cap, out_res;
+    for (int k = 0; k < lane_count; k++) {
+        wire_res[k] = c[k].unit_wire_res;
+        wire_cap[k] = c[k].unit_wire_cap;
+        out_cap[k] = c[k].inv_output_cap;
+        out_res[k] = c[k].inv_output_res;
+    }
+    // the same accumulation parseTopology does, children before parents
+    for (int i = 0; i < tree.parsed; i++) {
+        nodes[i].total = Lanes{} + tree.capacitance[i];
+        nodes[i].delay = Lanes{};
+        if (tree.type[i] != BRIDGE) {
+            continue;
+        }
+        int l = tree.left[i];
+        int r = tree.right[i];
+        Lanes l_wire_cap = wire_cap * tree.leftWire[i] / (double) 2;
+        Lanes r_wire_cap = wire_cap * tree.rightWire[i] / (double) 2;
+
+        nodes[l].total += l_wire_cap;
+        nodes[r].total += r_wire_cap;
+        nodes[l].delay += nodes[l].total;
+        nodes[r].delay += nodes[r].total;
+
+        nodes[i].total += l_wire_cap + r_wire_cap;
+        nodes[i].delay = nodes[l].delay + nodes[r].delay;
+    }
+    int root = tree.root;
+    nodes[root].total += out_cap;
+    nodes[root].delay += nodes[root].total;
+
+    // a node's capacitance is read for the last time right where its delay
+    // replaces it, when the parent is visited
+    nodes[root].delay = 0 + (out_res * nodes[root].delay);
+    for (int i = root; i >= 0; i--) {
+        if (tree.type[i] != BRIDGE) {
+            continue;
+        }
+        int l = tree.left[i];
+        int r = tree.right[i];
+        Lanes curr_elmore_delay = nodes[i].delay;
+        nodes[l].delay = curr_elmore_delay + (wire_res * tree.leftWire[i] * nodes[l].delay);
+        nodes[r].delay = curr_elmore_delay + (wire_res * tree.rightWire[i] * nodes[r].delay);
+    }
+}
+
+// Writes one out2 per corner, filenames[k] for corners[k]. The tree is only
+// walked once per four corners; its own capacitances are left alone.
+int elmoreDelayCorners(const Tree& tree, const std::vector<Context>& corners, const std::vector<std::string>& filenames) {
+    PA1_PHASE("elmore_corners");
+    std::vector<CornerNode> nodes(tree.parsed);
+
+    for (size_t first = 0; first < corners.size(); first += lane_count) {
+        // a partial group repeats its last corner in the unused lanes
+        Context group[lane_count];
+        int used = std::min((int) (corners.size() - first), lane_count);
+        for (int k = 0; k < lane_count; k++) {
+            group[k] = corners[first + std::min(k, used - 1)];
+        }
+        elmoreLanes(tree, group, nodes.data());
+
+        DelayWriter fps[lane_count];
+        for (int k = 0; k < used; k++) {
+            if (!fps[k].open(filenames[first + k], corners[first + k].io, corners[first + k].index_delays)) {
+                std::cout << "Error: cannot open file\n";
+                return 0;
+            }
+        }
+        for (int i = 0; i < tree.parsed; i++) {
+            if (tree.type[i]==LEAF) {
+                for (int k = 0; k < used; k++) {
+                    fps[k].put(tree.label[i], nodes[i].delay[k]);
+                }
+            }
+        }
+        for (int k = 0; k < used; k++) {
+            if (!fps[k].close()) {
+                return 0;
+            }
+        }
+    }
+    return 1;
+}
+
+double solveQuadratic(double A, double B, double C) {
+    PA1_COUNT(COUNT_QUADRATIC_SOLVES, 1);
+
+    double discriminant = (B*B) - (4*A*C);
+    double new_l = -1;
+
+    if (discriminant < 0) {
+        // complex roots, no solution
+        return -1;
+    } else if (discriminant == 0) {
+        new_l = (0-B) / (2*A);
+    }  else {
+
+        double first_root = (-B + (std::sqrt(discriminant))) / (2 * A);
+        double second_root = (-B - (std::sqrt(discriminant))) / (2 * A);
+
+        if (first_root > second_root) {
+            if (first_root < 0) {
+                return -1;
+            } else {
+                return first_root;
+            }
+        }
+        else {
+            if (second_root < 0) {
+                return -1;
+            } else {
+                return second_root;
+            }
+        }
+ 
+    }
+    return new_l;
+}
+
+// Length of wire one inverter can drive into the input of the next one,
+// -1 if it cannot drive even that. Every stage of a long wire past the first
+// is this long, so it is solved once per parameter set; one entry per thread
+// is enough since a thread works on one net at a time.
+double repeatedStageLength(const Context& ctx) {
+    struct Entry {
+        bool valid;
+        double unit_wire_res, unit_wire_cap;
+        double inv_input_cap, inv_output_cap, inv_output_res;
+        double time_constraint;
+        double length;
+    };
+    static thread_local Entry cached = {};
+
+    if (!cached.valid || cached.unit_wire_res != ctx.unit_wire_res || cached.unit_wire_cap != ctx.unit_wire_cap ||
+        cached.inv_input_cap != ctx.inv_input_cap || cached.inv_output_cap != ctx.inv_output_cap ||
+        cached.inv_output_res != ctx.inv_output_res || cached.time_constraint != ctx.time_constraint) {
+        double A = (ctx.unit_wire_cap * ctx.unit_wire_res) / 2;
+        double B = (ctx.inv_output_res * ctx.unit_wire_cap) + (ctx.unit_wire_res * ctx.inv_input_cap);
+        double C = (ctx.inv_output_res * ctx.inv_output_cap) + (ctx.inv_output_res * ctx.inv_input_cap) - ctx.time_constraint;
+        double length;
+        if (A > 0) {
+            length = solveQuadratic(A, B, C);
+        } else {
+            // ideal wire: the stage delay is linear in the length
+            length = (B > 0 && C <= 0) ? -C / B : -1;
+        }
+        cached = {true, ctx.unit_wire_res, ctx.unit_wire_cap, ctx.inv_input_cap, ctx.inv_output_cap,
+                  ctx.inv_output_res, ctx.time_constraint, length};
+    }
+    return cached.length;
+}
+
+template <class TreeT>
+int inverterSegmentation(const Context& ctx, TreeT& tree, int node, double l, double branch_time_constraint) {
+
+    int temp = node;
+    double temp_l = l;
+
+    double temp_time_constraint = ctx.time_constraint - branch_time_constraint;
+
+    double temp_elmore_c = tree.elmore_capacitance[temp] - ((temp_l * ctx.unit_wire_cap) / (double) 2);
+
+        // Quadratic coefficients
+    double A = (ctx.unit_wire_cap * ctx.unit_wire_res) / 2;
+    double B = (ctx.inv_output_res * ctx.unit_wire_cap) + (ctx.unit_wire_res * temp_elmore_c);
+    double C = (ctx.inv_output_res * ctx.inv_output_cap) + (ctx.inv_output_res * temp_elmore_c);
+
+    double stage_delay = (A*(l*l)) + (B*l) + C;
+
+    if (stage_delay <= temp_time_constraint) {
+        return temp;
+    }
+
+    // first stage: drives whatever hangs below the wire, within what the
+    // branch has left of the constraint
+    C -= temp_time_constraint;
+
+    double new_l = solveQuadratic(A, B, C);
+    if (new_l == -1) {
+        // try inserting on left and right
+        return temp;
+    }
+
+    // every later stage drives one inverter input and has the cached length,
+    // so the count and the cuts follow from the wire length alone
+    double stage_l = new_l;
+    int count = 1;
+    double rest = temp_l - new_l;
+    double repeated = repeatedStageLength(ctx);
+    if (rest > repeated && repeated > 0) {
+        // inverterInsertion has checked that the stages of every wire fit
+        double stages = std::ceil(rest / repeated);
+        count += (int) stages - 1;
+    }
+
+    for (int k = 0; k < count; k++) {
+        int inv = tree.addInverter(ctx.inv_input_cap, temp_l - stage_l);
+        tree.leftWire[inv] = stage_l;
+        tree.rightWire[inv] = -1;
+        tree.left[inv] = temp;
+        tree.total_capacitance[inv] = tree.capacitance[inv] + ((tree.cut_wire[inv] * ctx.unit_wire_cap) / 2);
+        tree.elmore_capacitance[inv] = tree.total_capacitance[inv];
+        tree.polarity[inv] = (1 + tree.polarity[temp])%2;
+
+        temp = inv;
+        temp_l -= stage_l;
+        stage_l = repeated;
+    }
+    PA1_COUNT(COUNT_SEGMENT_INVERTERS, count);
+    PA1_TRACE_DEBUG(TRACE_SEGMENTATION, "node %d: %d inverters on a wire of %e, first stage %e", node, count, l,
+                    new_l);
+
+    return temp;
+}
+
+// replaces the left child of node with new_child (an inverter on that wire)
+// and moves the wire capacitance of the cut over to the new wire length
+template <class TreeT>
+void replaceLeftChild(const Context& ctx, TreeT& tree, int node, int new_child) {
+    double old_child_cap = tree.elmore_capacitance[tree.left[node]];
+    tree.left[node] = new_child;
+
+    tree.total_capacitance[node]-=(tree.leftWire[node] * ctx.unit_wire_cap) / 2;
+    tree.elmore_capacitance[node]-=(tree.leftWire[node] * ctx.unit_wire_cap) / 2;
+    tree.elmore_capacitance[node]-=old_child_cap;
+
+    tree.leftWire[node] = tree.cut_wire[new_child];
+    tree.total_capacitance[node]+=(tree.leftWire[node] * ctx.unit_wire_cap) / 2; //good
+    tree.elmore_capacitance[node]+=tree.elmore_capacitance[new_child];
+    tree.elmore_capacitance[node]+=(tree.leftWire[node] * ctx.unit_wire_cap) / 2;
+}
+
+template <class TreeT>
+void replaceRightChild(const Context& ctx, TreeT& tree, int node, int new_child) {
+    double old_child_cap = tree.elmore_capacitance[tree.right[node]];
+    tree.right[node] = new_child;
+
+    tree.total_capacitance[node]-=(tree.rightWire[node] * ctx.unit_wire_cap) / 2;
+    tree.elmore_capacitance[node]-=(tree.rightWire[node] * ctx.unit_wire_cap) / 2;
+    tree.elmore_capacitance[node]-=old_child_cap;
+
+    tree.rightWire[node] = tree.cut_wire[new_child];
+
+    tree.total_capacitance[node]+=(tree.rightWire[node] * ctx.unit_wire_cap) / 2;
+    tree.elmore_capacitance[node]+=(tree.rightWire[node] * ctx.unit_wire_cap) / 2;
+    tree.elmore_capacitance[node]+=tree.elmore_capacitance[new_child];
+}
+
+// inverter with no wire of its own, sitting right on top of child
+template <class TreeT>
+int addPolarityInverter(const Context& ctx, TreeT& tree, int child, double wire) {
+    PA1_COUNT(COUNT_POLARITY_INVERTERS, 1);
+    int inv = tree.addInverter(ctx.inv_input_cap, 0);
+    tree.leftWire[inv] = wire;
+    tree.rightWire[inv] = -1;
+    tree.left[inv] = child;
+    tree.total_capacitance[inv] = tree.capacitance[inv] + ((tree.cut_wire[inv] * ctx.unit_wire_cap) / 2);
+    tree.elmore_capacitance[inv] = tree.total_capacitance[inv];
+
+    tree.polarity[inv] = (1 + tree.polarity[child])%2;
+    return inv;
+}
+
+// time constraint already used up below node by its slowest child wire
+template <class TreeT>
+double branchTimeConstraint(const Context& ctx, const TreeT& tree, int node) {
+    if (tree.type[node] == LEAF) {
+        return 0;
+    }
+    double t1 = (tree.leftWire[node])*ctx.unit_wire_res*(tree.elmore_capacitance[tree.left[node]]);
+    double t2 = (tree.rightWire[node])*ctx.unit_wire_res*(tree.elmore_capacitance[tree.right[node]]);
+    return (t1 > t2 ? t1 : t2);
+}
+
+// Segments the wires to the two children of node (whose subtrees are final
+// by then), hooks up the returned inverters and fixes polarity. left_btc and
+// right_btc are the branchTimeConstraint of the two children.
+template <class TreeT>
+void insertAtNode(const Context& ctx, TreeT& tree, int node, double left_btc, double right_btc) {
+    // temp will either carry original child or inverter
+    int temp_left = inverterSegmentation(ctx, tree, tree.left[node], tree.leftWire[node], left_btc);
+    if (tree.type[temp_left]==INV) {
+        //Left branch had an inverter inserted
+        replaceLeftChild(ctx, tree, node, temp_left);
+    }
+    int temp_right = inverterSegmentation(ctx, tree, tree.right[node], tree.rightWire[node], right_btc);
+    if (tree.type[temp_right]==INV) {
+        // right branch had an inverter inserted
+        replaceRightChild(ctx, tree, node, temp_right);
+        PA1_TRACE_DEBUG(TRACE_POLARITY, "node %d: right branch returns polarity %d", node, tree.polarity[temp_right]);
+    }
+
+    // check polarity
+    if (tree.polarity[temp_left] == 0 && tree.polarity[temp_right] == 1) {
+        // insert inverter on right branch at length l
+        int inv = addPolarityInverter(ctx, tree, tree.left[node], tree.leftWire[node]);
+        replaceLeftChild(ctx, tree, node, inv);
+        PA1_TRACE_DEBUG(TRACE_POLARITY, "node %d: polarity inverter on the left, cut wire %e", node, tree.cut_wire[inv]);
+
+        tree.polarity[node] = tree.polarity[inv];
+    } 
+    else if (tree.polarity[temp_left] == 1 && tree.polarity[temp_right] == 0){
+        // insert inverter on left branch at length l
+        int inv = addPolarityInverter(ctx, tree, tree.right[node], tree.rightWire[node]);
+        replaceRightChild(ctx, tree, node, inv);
+        PA1_TRACE_DEBUG(TRACE_POLARITY, "node %d: polarity inverter on the right, cut wire %e", node, tree.cut_wire[inv]);
+
+        tree.polarity[node] = tree.polarity[inv];
+    }
+    else {
+        tree.polarity[node] = tree.polarity[temp_left];
+    }
+}
+
+template <class TreeT>
+void insertAtNode(const Context& ctx, TreeT& tree, int node) {
+    insertAtNode(ctx, tree, node, branchTimeConstraint(ctx, tree, tree.left[node]),
+                 branchTimeConstraint(ctx, tree, tree.right[node]));
+}
+
+// Parsed nodes are in post-order, so a forward scan handles every subtree
+// before its parent. The root's own segmentation is left to the caller.
+void insertionPostOrder(const Context& ctx, Tree& tree) {
+    for (int node = 0; node < tree.parsed; node++) {
+        if (tree.type[node] == BRIDGE) {
+            insertAtNode(ctx, tree, node);
+        }
+    }
+}
+
+// What one insertion task sees while it runs: the parsed nodes of the shared
+// tree plus the inverters it made itself. Those stay in a buffer of its own,
+// at index parsed + j for the j-th one, until all tasks are merged. A task
+// only ever looks at its own inverters, so the index ranges may overlap.
+struct TaskTree {
+    template <class T>
+    struct Column {
+        std::pmr::vector<T>& shared;
+        std::pmr::vector<T>& local;
+        int parsed;
+
+        T& operator[](int i) const {
+            return i < parsed ? shared[i] : local[i - parsed];
+        }
+    };
+
+    Tree local;
+    int parsed;
+
+    Column<NodeType> type;
+    Column<double> capacitance, leftWire, rightWire;
+    Column<int> left, right;
+    Column<double> total_capacitance, elmore_capacitance, cut_wire;
+    Column<int> polarity;
+
+    explicit TaskTree(Tree& tree)
+        : parsed(tree.parsed),
+          type{tree.type, local.type, parsed},
+          capacitance{tree.capacitance, local.capacitance, parsed},
+          leftWire{tree.leftWire, local.leftWire, parsed},
+          rightWire{tree.rightWire, local.rightWire, parsed},
+          left{tree.left, local.left, parsed},
+          right{tree.right, local.right, parsed},
+          total_capacitance{tree.total_capacitance, local.total_capacitance, parsed},
+          elmore_capacitance{tree.elmore_capacitance, local.elmore_capacitance, parsed},
+          cut_wire{tree.cut_wire, local.cut_wire, parsed},
+          polarity{tree.polarity, local.polarity, parsed} {}
+
+    int addInverter(double cap, double wire_left) {
+        return parsed + local.addInverter(cap, wire_left);
+    }
+};
+
+// Insertion split into subtree tasks on the pool. Each task keeps its
+// inverters in its own buffer. Afterwards the buffers are appended in task
+// order, which does not depend on the thread count, and the indices are
+// fixed up, so the tree comes out the same for any number of threads.
+static void insertionParallel(const Context& ctx, Tree& tree, TaskPool& pool) {
+    std::vector<std::unique_ptr<SubtreeTask>> tasks = splitTree(tree);
+
+    // runs task id; the last child of a join to finish runs the join as well
+    std::function<void(int)> run = [&](int id) {
+        while (id >= 0) {
+            SubtreeTask& t = *tasks[id];
+            t.work = std::make_unique<TaskTree>(tree);
+            if (t.join) {
+                // the children's own inverters live in their tasks' buffers,
+                // so their constraints come from there
+                insertAtNode(ctx, *t.work, t.node, tasks[t.kids[0]]->btc, tasks[t.kids[1]]->btc);
+            } else {
+                for (int node = t.lo; node <= t.node; node++) {
+                    if (tree.type[node] == BRIDGE) {
+                        insertAtNode(ctx, *t.work, node);
+                    }
+                }
+            }
+            t.btc = branchTimeConstraint(ctx, *t.work, t.node);
+            id = t.parent;
+            if (id >= 0 && --tasks[id]->waiting > 0) {
+                return;
+            }
+        }
+    };
+    for (int id = 0; id < (int) tasks.size(); id++) {
+        if (!tasks[id]->join) {
+            pool.spawn([&run, id] { run(id); });
+        }
+    }
+    pool.wait();
+
+    // merge
+    int base = tree.size();
+    for (auto& t : tasks) {
+        t->base = base;
+        base += t->work->local.size();
+    }
+    tree.reserve(base);
+    for (auto& t : tasks) {
+        Tree& local = t->work->local;
+        int shift = t->base - tree.parsed;
+        for (int j = 0; j < local.size(); j++) {
+            int l = local.left[j];
+            int inv = tree.addInverter(local.capacitance[j], local.cut_wire[j]);
+            tree.leftWire[inv] = local.leftWire[j];
+            tree.rightWire[inv] = local.rightWire[j];
+            tree.left[inv] = (l >= tree.parsed) ? l + shift : l;
+            tree.total_capacitance[inv] = local.total_capacitance[j];
+            tree.elmore_capacitance[inv] = local.elmore_capacitance[j];
+            tree.polarity[inv] = local.polarity[j];
+        }
+        int from = t->join ? t->node : t->lo;
+        for (int node = from; node <= t->node; node++) {
+            if (tree.left[node] >= tree.parsed) tree.left[node] += shift;
+            if (tree.right[node] >= tree.parsed) tree.right[node] += shift;
+        }
+        t->work.reset();
+    }
+}
+
+// most inverters the greedy insertion can add to tree: every wire cut at
+// the repeated stage length, a polarity inverter at every bridge and the
+// ones at the root. Summed in double, so a huge wire cannot overflow it
+static double maxGreedyInverters(const Context& ctx, const Tree& tree) {
+    double repeated = repeatedStageLength(ctx);
+    auto stages = [repeated](double l) {
+        return repeated > 0 ? std::max(1.0, std::ceil(l / repeated)) : 1.0;
+    };
+    double total = 4;
+    for (int node = 0; node < tree.size(); node++) {
+        if (tree.type[node] == BRIDGE) {
+            total += stages(tree.leftWire[node]) + stages(tree.rightWire[node]) + 1;
+        }
+    }
+    return total;
+}
+
+int inverterInsertion(const Context& ctx, Tree& tree, TaskPool* pool) {
+    PA1_PHASE("insertion");
+    if (ctx.engine == ENGINE_DP) {
+        int root = inverterInsertionDP(ctx, tree);
+        if (root >= 0) {
+            return root;
+        }
+        cout << "The DP engine found no inverter placement with the sinks' polarity, using the greedy one" << endl;
+    }
+    if (!(maxGreedyInverters(ctx, tree) <= (double) (INT_MAX - tree.size()))) {
+        cout << "The wires need more inverters than a tree can hold" << endl;
+        return -1;
+    }
+
+    // the task split needs every subtree in one index range, which a shared
+    // tree does not have
+    if (pool && pool->size() > 1 && !tree.shared()) {
+        insertionParallel(ctx, tree, *pool);
+    } else {
+        insertionPostOrder(ctx, tree);
+    }
+    int temp_root = inverterSegmentation(ctx, tree, tree.root, 0, branchTimeConstraint(ctx, tree, tree.root));
+    PA1_TRACE_INFO(TRACE_SEGMENTATION, "%d inverters below the driver", tree.size() - tree.parsed);
+    return temp_root;
+
+}
+
+// inverters below root once every shared node is counted as often as it
+// occurs; a node's count is worked out once and then looked up
+static int expandedInverters(const Tree& tree, int root) {
+    std::vector<long> below(tree.size(), -1);
+    std::vector<int> st;
+    st.push_back(root);
+    while (!st.empty()) {
+        int node = st.back();
+        int l = tree.left[node];
+        int r = tree.right[node];
+        if ((l >= 0 && below[l] < 0) || (r >= 0 && below[r] < 0)) {
+            if (l >= 0 && below[l] < 0) st.push_back(l);
+            if (r >= 0 && below[r] < 0) st.push_back(r);
+            continue;
+        }
+        st.pop_back();
+        below[node] = (tree.type[node] == INV) + (l >= 0 ? below[l] : 0) + (r >= 0 ? below[r] : 0);
+    }
+    return (int) below[root];
+}
+
+// Runs the insertion for one constraint on a copy of tree, so tree itself
+// stays as parsed and can be shared by several sweeps at once. Returns the
+// number of inverters, including the ones at the driver that
+// write3rdOutputPost adds; out3/out4 are only written if named.
+int sweepConstraint(const Context& ctx, const Tree& tree, double constraint, const std::string& filename3, const std::string& filename4) {
+    PA1_PHASE("sweep");
+    Context sweep_ctx = ctx;
+    sweep_ctx.time_constraint = constraint;
+    Tree copy(tree);
+    int new_root = inverterInsertion(sweep_ctx, copy);
+    if (new_root < 0) {
+        return -1;
+    }
+
+    if (!filename3.empty() && !write3rdOutputPost(ctx, copy, new_root, filename3, filename4)) {
+        return -1;
+    }
+    int inverters = copy.shared() ? expandedInverters(copy, new_root) : copy.size() - copy.parsed;
+    return inverters + 1 + (copy.polarity[new_root] == 0);
+}
+
+// keep the Tree versions around for callers outside this file
+template int inverterSegmentation<Tree>(const Context&, Tree&, int, double, double);
+template void replaceLeftChild<Tree>(const Context&, Tree&, int, int);
+template void replaceRightChild<Tree>(const Context&, Tree&, int, int);
+template int addPolarityInverter<Tree>(const Context&, Tree&, int, double);
+template double branchTimeConstraint<Tree>(const Context&, const Tree&, int);
+
+// out3 to fout and out4 to fp, either of them may be left out
+static void postOrderOutput3(const Tree& tree, int root, BufferedWriter* fout, BufferedWriter* fp) {
+    // (node, children already pushed)
+    std::vector<std::pair<int, bool>> st;
+    st.push_back({root, false});
+    int sink = 0;
+
+    while (!st.empty()) {
+        int node = st.back().first;
+        if (!st.back().second) {
+            st.back().second = true;
+            if (tree.right[node] >= 0) st.push_back({tree.right[node], false});
+            if (tree.left[node] >= 0) st.push_back({tree.left[node], false});
+            continue;
+        }
+        st.pop_back();
+
+        if (tree.type[node]==LEAF) {
+            int lbl = sinkLabel(tree, node, sink++);
+            if (fout) printLeafLine(*fout, lbl, tree.capacitance[node]);
+            if (fp) putLeafRecord(*fp, lbl, tree.capacitance[node]);
+
+        } else if (tree.type[node]==BRIDGE){
+            if (fp) putWireRecord(*fp, tree.leftWire[node], tree.rightWire[node], 0);
+            if (fout) printWireLine(*fout, tree.leftWire[node], tree.rightWire[node], " 0");
+        } else {
+
+            if (fp) putWireRecord(*fp, tree.leftWire[node], -1, 1);
+            if (fout) printWireLine(*fout, tree.leftWire[node], tree.rightWire[node], " 1");
+
+        }
+    }
+}
+
+void postOrderTraversalOutput3(const Tree& tree, int root, BufferedWriter& fout, BufferedWriter& fp) {
+    postOrderOutput3(tree, root, &fout, &fp);
+}
+
+int write3rdOutputPost(const Context& ctx, const Tree& tree, int root, const std::string& filename, const std::string& filename2) {
+    PA1_PHASE("out3");
+    BufferedWriter fout;
+    if (!fout.open(filename, ctx.io)) {
+        std::cout << "Error: cannot open file\n";
+        return 0;
+    }
+
+    BufferedWriter fp;
+    if (!fp.open(filename2, ctx.io)) {
+        std::cout << "Error: cannot open file\n";
+        return 0;
+    }
+
+    if (ctx.pipeline) {
+        // the tree is only read from here on, so out4 gets a walk of its own
+        std::thread out4([&] { postOrderOutput3(tree, root, nullptr, &fp); });
+        postOrderOutput3(tree, root, &fout, nullptr);
+        out4.join();
+    } else {
+        postOrderOutput3(tree, root, &fout, &fp);
+    }
+    // the driver: one inverter, and a second one if the root is inverted
+    int drivers = (tree.polarity[root]==0) ? 2 : 1;
+    for (int k = 0; k < drivers; k++) {
+        printWireLine(fout, 0, -1, " 1");
+        putWireRecord(fp, 0, -1, 1);
+    }
+
+    int ok = fout.close();
+    return fp.close() && ok;
+}
+
+// drops every array of the tree and hands all of its memory back to the arena
+void freeMyTree(Tree& tree, Arena& arena) {
+    tree = Tree(&arena);
+    arena.reset();
+}
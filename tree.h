@@ -0,0 +1,211 @@
+#ifndef TREE_H
+#define TREE_H
+
+#include <cstdint>
+#include <cstdio>
+#include <fstream>
+#include <memory_resource>
+#include <string>
+#include <vector>
+#include "arena.h"
+#include "taskpool.h"
+#include "writer.h"
+#include "delayfile.h"
+
+// how inverterInsertion places inverters
+enum InsertionEngine {
+    ENGINE_GREEDY,  // segment every wire as far as it goes, then fix polarity
+    ENGINE_DP       // candidate lists with pruning, buffering.cpp
+};
+
+// Everything a net is evaluated with. The engine keeps no state of its own,
+// so nets with different contexts can be run side by side in one process.
+// A process corner is a context with its own wire and inverter parameters.
+struct Context {
+    double unit_wire_res = 0;
+    double unit_wire_cap = 0;
+
+    double inv_input_cap = 0;
+    double inv_output_cap = 0;
+    double inv_output_res = 0;
+
+    double time_constraint = 0;
+
+    IoMode io = IO_WRITE;     // how the output files are written
+    InsertionEngine engine = ENGINE_GREEDY;
+    int dp_points_per_stage = 4;    // DP candidate positions per longest drivable wire
+    bool share_subtrees = false;    // parse identical subtrees into one node
+    bool index_delays = false;      // out2 in the indexed layout, delayfile.h
+    bool pipeline = false;          // write the outputs on threads of their own while the analysis goes on
+};
+
+enum NodeType : unsigned char {
+    LEAF,
+    BRIDGE,
+    INV
+};
+
+
+// Tree stored as structure-of-arrays. Parsed nodes keep the post-order of the
+// input file (children always have smaller indices than their parent), and
+// inverters added during insertion are appended after them. Child links are
+// indices into the same arrays, -1 if there is no child. All arrays allocate
+// from the memory resource given at construction (normally the net's Arena).
+struct Tree {
+    std::pmr::vector<NodeType> type;
+    std::pmr::vector<int> label;                 // valid if LEAF
+    std::pmr::vector<double> capacitance;        // sink cap if LEAF, input cap if INV
+
+    std::pmr::vector<double> leftWire, rightWire;   // valid if !LEAF
+    std::pmr::vector<int> left;
+    std::pmr::vector<int> right;
+
+    std::pmr::vector<double> total_capacitance;
+    std::pmr::vector<double> elmore_capacitance;
+    std::pmr::vector<double> elmore_delay;
+
+    std::pmr::vector<double> cut_wire;
+
+    std::pmr::vector<int> polarity;
+
+    // Only for a shared tree (Context::share_subtrees): the labels of all
+    // sinks, left to right. Identical subtrees under the same wire length
+    // are then one node with several parents, so the arrays hold a DAG and
+    // label[] is not per sink; the writers expand it again.
+    std::pmr::vector<int> sink_labels;
+
+    int root = -1;
+    int parsed = 0;   // number of nodes read from the input, inverters come after
+
+    explicit Tree(std::pmr::memory_resource* mr = std::pmr::get_default_resource())
+        : type(mr), label(mr), capacitance(mr), leftWire(mr), rightWire(mr),
+          left(mr), right(mr), total_capacitance(mr), elmore_capacitance(mr),
+          elmore_delay(mr), cut_wire(mr), polarity(mr), sink_labels(mr) {}
+
+    bool shared() const {
+        return !sink_labels.empty();
+    }
+
+    int size() const {
+        return (int) type.size();
+    }
+
+    void reserve(size_t n) {
+        type.reserve(n);
+        label.reserve(n);
+        capacitance.reserve(n);
+        leftWire.reserve(n);
+        rightWire.reserve(n);
+        left.reserve(n);
+        right.reserve(n);
+        total_capacitance.reserve(n);
+        elmore_capacitance.reserve(n);
+        elmore_delay.reserve(n);
+        cut_wire.reserve(n);
+        polarity.reserve(n);
+    }
+
+    int addNode(NodeType t, int lbl, double cap, double lw, double rw, int l, int r, double cut) {
+        type.push_back(t);
+        label.push_back(lbl);
+        capacitance.push_back(cap);
+        leftWire.push_back(lw);
+        rightWire.push_back(rw);
+        left.push_back(l);
+        right.push_back(r);
+        total_capacitance.push_back(0.0);
+        elmore_capacitance.push_back(0.0);
+        elmore_delay.push_back(0.0);
+        cut_wire.push_back(cut);
+        polarity.push_back(0);
+        return size() - 1;
+    }
+
+    int addLeaf(int lbl, double cap) {
+        return addNode(LEAF, lbl, cap, 0, 0, -1, -1, 0);
+    }
+
+    int addBridge(double lw, double rw, int l, int r) {
+        return addNode(BRIDGE, -1, 0, lw, rw, l, r, 0);
+    }
+
+    int addInverter(double cap, double wire_left) {
+        return addNode(INV, -1, cap, 0, 0, -1, -1, wire_left);
+    }
+};
+
+
+int storeWireParams(const std::string& filename, Context& ctx);
+int storeInvParams(const std::string& filename, Context& ctx);
+int storeWireParams(const std::vector<std::string>& filenames, std::vector<Context>& corners);
+int storeInvParams(const std::vector<std::string>& filenames, std::vector<Context>& corners);
+
+// With ctx.share_subtrees the tree comes out shared; only the greedy engine
+// and the plain outputs work on it, not corners, ECO or streaming. Large
+// inputs are decoded on pool if there is one, with the same result.
+int parseTopology(const Context& ctx, const char* begin, const char* end, Tree& tree, TaskPool* pool = nullptr);
+// Binary topology, the record layout of out4 (see binary_read.py). The
+// extended variant starts with this header so the tree can be sized
+// exactly; all counts are records, inverters are the one-child ones.
+struct BtopoHeader {
+    char magic[8];          // "BTOPO1" and two zero bytes
+    uint64_t sinks;
+    uint64_t bridges;
+    uint64_t inverters;
+};
+int parseBinaryTopology(const Context& ctx, const char* begin, const char* end, Tree& tree);
+// Compact topology (see ctopo.h), header included
+int parseCompactTopology(const Context& ctx, const char* begin, const char* end, Tree& tree);
+// text, binary or compact, by the .btopo/.ctopo extension or the header
+int parseTree(const Context& ctx, const std::string& filename, Tree& tree, TaskPool* pool = nullptr);
+int isBinaryTopology(const std::string& filename);
+int isCompactTopology(const std::string& filename);
+
+// left_wire/right_wire, if given, are printed for the bridges instead of the
+// tree's own wires
+void preOrderTraversal(const Tree& tree, BufferedWriter& fout, const double* left_wire = nullptr,
+                       const double* right_wire = nullptr);
+int writePre(const Context& ctx, const Tree& tree, const std::string& filename);
+
+// with a pool of more than one thread the tree is split into subtree tasks;
+// the results are the same for any number of threads
+void delayPreOrder(const Context& ctx, Tree& tree, DelayWriter& fp, TaskPool* pool = nullptr);
+int elmoreDelay(const Context& ctx, Tree& tree, const std::string& filename, TaskPool* pool = nullptr);
+// the same into a writer that is already open, which the caller closes
+void elmoreDelay(const Context& ctx, Tree& tree, DelayWriter& fp, TaskPool* pool = nullptr);
+// the out2 records from the delays already in the tree
+void writeLeafDelays(const Tree& tree, DelayWriter& fp);
+// out2 from them, without redoing the pass
+int writeDelays(const Context& ctx, const Tree& tree, const std::string& filename);
+int elmoreDelayCorners(const Tree& tree, const std::vector<Context>& corners, const std::vector<std::string>& filenames);
+int elmoreDelayStreaming(const Context& ctx, const std::string& topology, const std::string& filename);
+
+double solveQuadratic(double A, double B, double C);
+// wire length between two inverters in a row, cached per parameter set
+double repeatedStageLength(const Context& ctx);
+// templates over the tree type so the parallel pass can run them on a view
+// with task-local inverters; instantiated for Tree in tree.cpp
+template <class TreeT>
+int inverterSegmentation(const Context& ctx, TreeT& tree, int node, double l, double branch_time_constraint);
+template <class TreeT>
+void replaceLeftChild(const Context& ctx, TreeT& tree, int node, int new_child);
+template <class TreeT>
+void replaceRightChild(const Context& ctx, TreeT& tree, int node, int new_child);
+template <class TreeT>
+int addPolarityInverter(const Context& ctx, TreeT& tree, int child, double wire);
+template <class TreeT>
+double branchTimeConstraint(const Context& ctx, const TreeT& tree, int node);
+void insertionPostOrder(const Context& ctx, Tree& tree);
+// new root, or -1 if the wires need more inverters than node indices reach
+int inverterInsertion(const Context& ctx, Tree& tree, TaskPool* pool = nullptr);
+// new root, or -1 with the tree untouched if no placement gets every sink
+// the right polarity (inverterInsertion then falls back to the greedy one)
+int inverterInsertionDP(const Context& ctx, Tree& tree);
+int sweepConstraint(const Context& ctx, const Tree& tree, double constraint, const std::string& filename3, const std::string& filename4);
+
+void postOrderTraversalOutput3(const Tree& tree, int root, BufferedWriter& fout, BufferedWriter& fp);
+int write3rdOutputPost(const Context& ctx, const Tree& tree, int root, const std::string& filename, const std::string& filename2);
+
+void freeMyTree(Tree& tree, Arena& arena);
+
+#endif
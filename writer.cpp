@@ -0,0 +1,132 @@
+#include "writer.h"
+#include "instrument.h"
+#include <cstdlib>
+#include <fcntl.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+// O_DIRECT wants offsets and lengths in multiples of this
+static const size_t direct_block = 4096;
+
+BufferedWriter::~BufferedWriter() {
+    close();
+}
+
+int BufferedWriter::open(const std::string& filename, IoMode m) {
+    close();
+    mode = m;
+    failed = false;
+
+    if (mode == IO_DIRECT) {
+        fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_DIRECT, 0644);
+        if (fd < 0) {
+            // tmpfs and some others refuse O_DIRECT
+            mode = IO_WRITE;
+        }
+    }
+    if (fd < 0) {
+        fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    }
+    if (fd < 0) {
+        return 0;
+    }
+
+    int count = (mode == IO_WRITEV) ? writev_buffers : 1;
+    for (int i = 0; i < count; i++) {
+        buffers.push_back(static_cast<char*>(aligned_alloc(direct_block, buffer_size)));
+    }
+    used.assign(count, 0);
+    current = 0;
+    pos = buffers[0];
+    limit = pos + buffer_size;
+    return 1;
+}
+
+// writes all of [p, p + n), retrying short writes
+static bool writeAll(int fd, const char* p, size_t n) {
+    while (n > 0) {
+        ssize_t w = write(fd, p, n);
+        if (w <= 0) {
+            return false;
+        }
+        PA1_COUNT(COUNT_BYTES_WRITTEN, w);
+        p += w;
+        n -= w;
+    }
+    return true;
+}
+
+void BufferedWriter::nextBuffer() {
+    used[current] = pos - buffers[current];
+    if (mode == IO_WRITEV && current + 1 < (int) buffers.size()) {
+        current++;
+        pos = buffers[current];
+        limit = pos + buffer_size;
+        return;
+    }
+    flush(false);
+}
+
+// Hands buffers 0..current to the kernel. Unless this is the last flush, an
+// O_DIRECT file only gets whole blocks; the rest moves to the front.
+void BufferedWriter::flush(bool last) {
+    used[current] = pos - buffers[current];
+
+    if (mode == IO_WRITEV && current > 0) {
+        std::vector<iovec> iov(current + 1);
+        size_t total = 0;
+        for (int i = 0; i <= current; i++) {
+            iov[i].iov_base = buffers[i];
+            iov[i].iov_len = used[i];
+            total += used[i];
+        }
+        ssize_t w = writev(fd, iov.data(), (int) iov.size());
+        if (w != (ssize_t) total) {
+            // finish by hand what a short writev left over
+            size_t done = w < 0 ? 0 : w;
+            for (int i = 0; i <= current && !failed; i++) {
+                if (done >= used[i]) {
+                    done -= used[i];
+                    continue;
+                }
+                failed = !writeAll(fd, buffers[i] + done, used[i] - done);
+                done = 0;
+            }
+        }
+    } else if (mode == IO_DIRECT) {
+        size_t n = used[0];
+        size_t whole = n - n % direct_block;
+        failed |= !writeAll(fd, buffers[0], whole);
+        if (!last) {
+            // keep the partial block for the next flush
+            memmove(buffers[0], buffers[0] + whole, n - whole);
+            pos = buffers[0] + (n - whole);
+            limit = buffers[0] + buffer_size;
+            return;
+        }
+        // the tail is not a whole block, so it goes through the page cache
+        fcntl(fd, F_SETFL, fcntl(fd, F_GETFL) & ~O_DIRECT);
+        failed |= !writeAll(fd, buffers[0] + whole, n - whole);
+    } else {
+        failed |= !writeAll(fd, buffers[0], used[0]);
+    }
+
+    current = 0;
+    pos = buffers[0];
+    limit = pos + buffer_size;
+}
+
+int BufferedWriter::close() {
+    if (fd < 0) {
+        return 1;
+    }
+    flush(true);
+    failed |= ::close(fd) != 0;
+    fd = -1;
+    for (char* b : buffers) {
+        free(b);
+    }
+    buffers.clear();
+    pos = limit = nullptr;
+    return failed ? 0 : 1;
+}
@@ -0,0 +1,106 @@
+#ifndef WRITER_H
+#define WRITER_H
+
+#include <charconv>
+#include <cstring>
+#include <string>
+#include <vector>
+
+// How BufferedWriter hands full buffers to the kernel.
+//   IO_WRITE   one write(2) per buffer
+//   IO_WRITEV  buffers are collected and go out in one writev(2)
+//   IO_DIRECT  O_DIRECT, page cache bypassed (falls back to IO_WRITE where
+//              the file system does not support it)
+enum IoMode {
+    IO_WRITE,
+    IO_WRITEV,
+    IO_DIRECT
+};
+
+// Output file with a large user-space buffer. Binary records are packed
+// straight into the buffer; text goes through std::to_chars, which prints
+// the same digits as an ostream with std::scientific and the default
+// precision of 6.
+class BufferedWriter {
+public:
+    BufferedWriter() = default;
+    ~BufferedWriter();
+
+    BufferedWriter(const BufferedWriter&) = delete;
+    BufferedWriter& operator=(const BufferedWriter&) = delete;
+
+    // returns 0 if the file cannot be created
+    int open(const std::string& filename, IoMode mode = IO_WRITE);
+    // writes out what is left; returns 0 if any write failed
+    int close();
+
+    // ---- binary ----
+    void put(const void* data, size_t n) {
+        const char* p = static_cast<const char*>(data);
+        while (n > (size_t) (limit - pos)) {
+            size_t part = limit - pos;
+            memcpy(pos, p, part);
+            pos += part;
+            p += part;
+            n -= part;
+            nextBuffer();
+        }
+        memcpy(pos, p, n);
+        pos += n;
+    }
+
+    void putInt(int v) {
+        put(&v, sizeof(v));
+    }
+
+    void putDouble(double v) {
+        put(&v, sizeof(v));
+    }
+
+    // ---- text ----
+    void print(const char* s) {
+        put(s, strlen(s));
+    }
+
+    void print(char c) {
+        room(1);
+        *pos++ = c;
+    }
+
+    void print(int v) {
+        room(16);
+        pos = std::to_chars(pos, limit, v).ptr;
+    }
+
+    // same as << std::scientific << v, or printf("%.*e", precision, v)
+    void printSci(double v, int precision = 6) {
+        room(40);
+        pos = std::to_chars(pos, limit, v, std::chars_format::scientific, precision).ptr;
+    }
+
+private:
+    static const size_t buffer_size = 1 << 20;    // multiple of the O_DIRECT block
+    static const int writev_buffers = 8;
+
+    int fd = -1;
+    IoMode mode = IO_WRITE;
+    bool failed = false;
+
+    std::vector<char*> buffers;
+    std::vector<size_t> used;   // bytes in each buffer, up to current
+    int current = 0;          // buffer being filled
+    char* pos = nullptr;
+    char* limit = nullptr;
+
+    // makes sure n bytes fit into the current buffer
+    void room(size_t n) {
+        if ((size_t) (limit - pos) < n) {
+            nextBuffer();
+        }
+    }
+
+    void nextBuffer();
+    void flush(bool last);
+};
+
+#endif